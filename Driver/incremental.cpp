@@ -0,0 +1,385 @@
+#include "incremental.hpp"
+#include "lexer.hpp"
+#include "ir_generator.hpp"
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+constexpr uint64_t FNV_OFFSET = 1469598103934665603ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+void hashBytes(uint64_t &hash, const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+}
+
+template <typename T>
+void hashValue(uint64_t &hash, const T &value) {
+    hashBytes(hash, &value, sizeof(value));
+}
+
+// Token range [begin, end). Lines are hashed relative to the first token so
+// the fingerprint describes the text of the segment, not where it sits.
+uint64_t fingerprintTokens(const std::vector<Token> &tokens, size_t begin, size_t end) {
+    uint64_t hash = FNV_OFFSET;
+    int baseLine = tokens[begin].line;
+    for (size_t i = begin; i < end; ++i) {
+        const Token &token = tokens[i];
+        hashValue(hash, token.type);
+        hashValue(hash, token.line - baseLine);
+        hashValue(hash, token.column);
+        hashValue(hash, token.value.size());
+        hashBytes(hash, token.value.data(), token.value.size());
+    }
+    return hash;
+}
+
+uint64_t hashSymbolInfo(const SymbolInfo &info) {
+    uint64_t hash = FNV_OFFSET;
+    hashValue(hash, info.name);
+    hashValue(hash, info.type);
+    hashValue(hash, info.returns);
+    hashValue(hash, info.isFunction);
+    hashValue(hash, info.isInitialized);
+    hashValue(hash, info.isPure);
+    for (const auto &[type, name] : info.params()) {
+        hashValue(hash, type);
+        hashValue(hash, name);
+    }
+    return hash;
+}
+
+// Order-independent digest of the global scope.
+uint64_t hashGlobals(const std::unordered_map<Symbol, SymbolInfo> &globals) {
+    uint64_t hash = globals.size();
+    for (const auto &entry : globals) {
+        hash += hashSymbolInfo(entry.second) * FNV_PRIME;
+    }
+    return hash;
+}
+
+// Moves every position under `node` down by `lines`.
+void shiftLines(ASTNode *node, int lines) {
+    if (!node) return;
+
+    switch (node->kind) {
+        case NodeKind::Return: {
+            auto ret = static_cast<ReturnNode *>(node);
+            ret->line += lines;
+            shiftLines(ret->returnExpression.get(), lines);
+            break;
+        }
+        case NodeKind::Variable:
+            static_cast<VariableNode *>(node)->line += lines;
+            break;
+        case NodeKind::Declaration:
+            for (const auto &decl : static_cast<DeclarationNode *>(node)->declarations) {
+                shiftLines(decl.get(), lines);
+            }
+            break;
+        case NodeKind::VarDeclare: {
+            auto decl = static_cast<VarDeclareNode *>(node);
+            decl->name.line += lines;
+            shiftLines(decl->initializer.get(), lines);
+            break;
+        }
+        case NodeKind::NumberLiteral:
+            static_cast<NumberLiteralNode *>(node)->line += lines;
+            break;
+        case NodeKind::StringLiteral:
+            static_cast<StringLiteralNode *>(node)->line += lines;
+            break;
+        case NodeKind::IfStatement: {
+            auto ifNode = static_cast<IfStatementNode *>(node);
+            ifNode->line += lines;
+            for (const auto &[condition, block] : ifNode->conditionBlocks) {
+                shiftLines(condition.get(), lines);
+                shiftLines(block.get(), lines);
+            }
+            shiftLines(ifNode->elseBranch.get(), lines);
+            break;
+        }
+        case NodeKind::Comparison: {
+            auto cmp = static_cast<ComparisonNode *>(node);
+            cmp->line += lines;
+            shiftLines(cmp->leftExpression.get(), lines);
+            shiftLines(cmp->rightExpression.get(), lines);
+            break;
+        }
+        case NodeKind::LogicalExpr: {
+            auto logical = static_cast<LogicalExprNode *>(node);
+            logical->line += lines;
+            shiftLines(logical->leftExpression.get(), lines);
+            shiftLines(logical->rightExpression.get(), lines);
+            break;
+        }
+        case NodeKind::BinaryExpr: {
+            auto binary = static_cast<BinaryExprNode *>(node);
+            binary->line += lines;
+            shiftLines(binary->left.get(), lines);
+            shiftLines(binary->right.get(), lines);
+            break;
+        }
+        case NodeKind::UnaryExpr: {
+            auto unary = static_cast<UnaryExprNode *>(node);
+            unary->line += lines;
+            shiftLines(unary->operand.get(), lines);
+            break;
+        }
+        case NodeKind::Assignment: {
+            auto assign = static_cast<AssignmentNode *>(node);
+            assign->line += lines;
+            shiftLines(assign->left.get(), lines);
+            shiftLines(assign->rightExpression.get(), lines);
+            break;
+        }
+        case NodeKind::Print: {
+            auto print = static_cast<PrintNode *>(node);
+            print->line += lines;
+            shiftLines(print->expression.get(), lines);
+            break;
+        }
+        case NodeKind::Function: {
+            auto func = static_cast<FunctionNode *>(node);
+            func->line += lines;
+            shiftLines(func->functionBlock.get(), lines);
+            break;
+        }
+        case NodeKind::CallExpr: {
+            auto call = static_cast<CallExprNode *>(node);
+            call->line += lines;
+            for (const auto &arg : call->arguments) {
+                shiftLines(arg.get(), lines);
+            }
+            break;
+        }
+        case NodeKind::While: {
+            auto whileNode = static_cast<WhileNode *>(node);
+            whileNode->line += lines;
+            shiftLines(whileNode->conditionStatement.get(), lines);
+            shiftLines(whileNode->whileBlock.get(), lines);
+            break;
+        }
+        case NodeKind::Block: {
+            auto block = static_cast<BlockNode *>(node);
+            block->line += lines;
+            for (const auto &stmt : block->statements) {
+                shiftLines(stmt.get(), lines);
+            }
+            break;
+        }
+        case NodeKind::ArrayAlloc: {
+            auto alloc = static_cast<ArrayAllocNode *>(node);
+            alloc->line += lines;
+            shiftLines(alloc->size.get(), lines);
+            break;
+        }
+        case NodeKind::Index: {
+            auto index = static_cast<IndexNode *>(node);
+            index->line += lines;
+            shiftLines(index->array.get(), lines);
+            shiftLines(index->index.get(), lines);
+            break;
+        }
+    }
+}
+
+// Scope names end in "$line$col" (see generateUniqueScopeName); moves the
+// line down by `lines`. "global" has no position and is returned as is.
+std::string shiftScopeName(const std::string &name, int lines) {
+    size_t colMark = name.rfind('$');
+    if (colMark == std::string::npos || colMark == 0) {
+        return name;
+    }
+    size_t lineMark = name.rfind('$', colMark - 1);
+    if (lineMark == std::string::npos) {
+        return name;
+    }
+    int line = std::stoi(name.substr(lineMark + 1, colMark - lineMark - 1));
+    return name.substr(0, lineMark + 1) + std::to_string(line + lines) + name.substr(colMark);
+}
+
+// Cuts the token stream (minus END_OF_FILE) into [begin, end) ranges: one
+// per top-level function, plus one for each run of statements between them.
+std::vector<std::pair<size_t, size_t>> splitSegments(const std::vector<Token> &tokens) {
+    std::vector<std::pair<size_t, size_t>> ranges;
+    size_t begin = 0;
+    int depth = 0;
+    bool inFunction = false;
+
+    for (size_t i = 0; i < tokens.size() && tokens[i].type != TokenType::END_OF_FILE; ++i) {
+        const Token &token = tokens[i];
+        if (depth == 0 && token.type == TokenType::FUNC) {
+            if (i > begin) {
+                ranges.emplace_back(begin, i);
+            }
+            begin = i;
+            inFunction = true;
+        } else if (token.type == TokenType::LBRACE) {
+            depth++;
+        } else if (token.type == TokenType::RBRACE && depth > 0) {
+            depth--;
+            if (depth == 0 && inFunction) {
+                ranges.emplace_back(begin, i + 1);
+                begin = i + 1;
+                inFunction = false;
+            }
+        }
+    }
+
+    size_t end = begin;
+    while (end < tokens.size() && tokens[end].type != TokenType::END_OF_FILE) {
+        end++;
+    }
+    if (end > begin) {
+        ranges.emplace_back(begin, end);
+    }
+    return ranges;
+}
+
+} // namespace
+
+void IncrementalCompiler::moveSegment(Segment &segment, int baseLine) {
+    int lines = baseLine - segment.baseLine;
+    if (lines == 0) {
+        return;
+    }
+    segment.baseLine = baseLine;
+
+    shiftLines(segment.root.get(), lines);
+    for (ParseError &error : segment.errors) {
+        error.line += lines;
+    }
+    for (LocationEntry &entry : segment.fragment.locations) {
+        if (entry.location.known()) {
+            entry.location.line += lines;
+        }
+    }
+    // The tables may still be shared with the analyzer's previous run. A
+    // block's table is a copy of its function's and keeps that name.
+    for (auto &[name, table] : segment.tables) {
+        name = shiftScopeName(name, lines);
+        table = std::make_shared<SymbolTable>(*table);
+        table->setScopeName(shiftScopeName(table->getCurrentScopeName(), lines));
+    }
+}
+
+bool IncrementalCompiler::update(const std::string &source) {
+    stats = Stats{};
+    errors.clear();
+    semanticErrorMessage.clear();
+    ir.clear();
+
+    Lexer lexer(source);
+    std::vector<Token> tokens;
+    Token token;
+    do {
+        token = lexer.getNextToken();
+        tokens.push_back(token);
+    } while (token.type != TokenType::END_OF_FILE);
+
+    // Previous segments by content, wherever they were; anything matching is
+    // moved over and, if it now starts on another line, moved down to it.
+    std::unordered_multimap<uint64_t, size_t> previous;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        previous.emplace(segments[i].fingerprint, i);
+    }
+
+    std::vector<Segment> next;
+    for (const auto &[begin, end] : splitSegments(tokens)) {
+        uint64_t fingerprint = fingerprintTokens(tokens, begin, end);
+        int baseLine = tokens[begin].line;
+
+        auto found = previous.find(fingerprint);
+        if (found != previous.end()) {
+            Segment &reused = segments[found->second];
+            previous.erase(found);
+            moveSegment(reused, baseLine);
+            next.push_back(std::move(reused));
+            continue;
+        }
+
+        Segment segment;
+        segment.fingerprint = fingerprint;
+        segment.baseLine = baseLine;
+        segment.arena = std::make_unique<AstArena>();
+
+        std::vector<Token> slice(tokens.begin() + begin, tokens.begin() + end);
+        const Token &stop = tokens[end];
+        slice.emplace_back(TokenType::END_OF_FILE, "", stop.line, stop.column);
+
+        Parser parser(std::move(slice), *segment.arena);
+        ParseResult result = parser.parseProgram();
+        segment.root = result.root;
+        segment.errors = std::move(result.errors);
+
+        stats.reparsed++;
+        next.push_back(std::move(segment));
+    }
+    segments = std::move(next);
+    stats.segments = segments.size();
+
+    for (const Segment &segment : segments) {
+        errors.insert(errors.end(), segment.errors.begin(), segment.errors.end());
+    }
+    if (!errors.empty()) {
+        return false;
+    }
+
+    // Semantic analysis runs front to back because each segment sees the
+    // globals of the ones before it. A segment is replayed from its previous
+    // run when it starts from the same set of globals.
+    semanticAnalyzer.beginProgram();
+    uint64_t envHash = hashGlobals(semanticAnalyzer.getSymbolTable("global").getScope());
+
+    for (Segment &segment : segments) {
+        if (segment.analyzed && segment.envHash == envHash) {
+            for (const SymbolInfo &info : segment.exports) {
+                semanticAnalyzer.declareGlobal(info);
+            }
+            semanticAnalyzer.adoptSymbolTables(segment.tables);
+        } else {
+            auto before = semanticAnalyzer.getSymbolTable("global").getScope();
+            size_t mark = semanticAnalyzer.symbolTableMark();
+
+            segment.analyzed = false;
+            segment.envHash = envHash;
+            try {
+                semanticAnalyzer.analyzeStatements(segment.root.get());
+            } catch (const std::runtime_error &e) {
+                semanticErrorMessage = e.what();
+                return false;
+            }
+
+            // Exports are every global the segment added or changed (a body
+            // may also initialise a global declared further up).
+            segment.exports.clear();
+            for (const auto &[name, info] : semanticAnalyzer.getSymbolTable("global").getScope()) {
+                auto old = before.find(name);
+                if (old == before.end() || hashSymbolInfo(old->second) != hashSymbolInfo(info)) {
+                    segment.exports.push_back(info);
+                }
+            }
+            segment.tables = semanticAnalyzer.symbolTablesSince(mark);
+            segment.analyzed = true;
+            stats.reanalyzed++;
+
+            // Lowering reads the slots the analyzer just assigned.
+            IRGenerator irGenerator;
+            irGenerator.generate(segment.root.get());
+            segment.fragment = irGenerator.getIR();
+            stats.regenerated++;
+        }
+        envHash = hashGlobals(semanticAnalyzer.getSymbolTable("global").getScope());
+    }
+
+    for (const Segment &segment : segments) {
+        ir.append(segment.fragment);
+    }
+    return true;
+}
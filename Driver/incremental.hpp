@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ast_arena.hpp"
+#include "ir.hpp"
+#include "parser.hpp"
+#include "semantic_analyzer.hpp"
+
+/*
+    Front end for callers that recompile the same file over and over (editor
+    integration, hot reload). The token stream is cut into top-level segments:
+    each top-level function is a segment of its own, and the statements
+    between functions form the segments around them. A segment's parse tree,
+    symbol tables and IR fragment are kept from one update() to the next and
+    reused as long as
+
+      - its tokens are unchanged (same fingerprint, which leaves out where
+        the segment starts), and
+      - the globals declared by the segments before it are unchanged.
+
+    A segment reused on another line than before has the positions in its
+    tree, diagnostics, IR and scope names moved by the difference, so an
+    edit near the top of a file does not invalidate everything below it.
+
+    Everything else is reparsed, reanalyzed and regenerated, then the IR
+    fragments are linked back together in source order. Lexing is always
+    redone for the whole file.
+*/
+class IncrementalCompiler {
+public:
+    struct Stats {
+        size_t segments = 0;
+        size_t reparsed = 0;
+        size_t reanalyzed = 0;
+        size_t regenerated = 0;
+    };
+
+    // Returns true when the whole source parsed and analyzed cleanly.
+    bool update(const std::string &source);
+
+    const IR &getIR() const { return ir; }
+    const std::vector<ParseError> &parseErrors() const { return errors; }
+    const std::string &semanticError() const { return semanticErrorMessage; }
+    const SemanticAnalyzer &analyzer() const { return semanticAnalyzer; }
+    const Stats &lastStats() const { return stats; }
+
+private:
+    struct Segment {
+        uint64_t fingerprint = 0;
+        int baseLine = 0;
+        uint64_t envHash = 0;   // globals visible when the segment starts
+        bool analyzed = false;
+
+        std::unique_ptr<AstArena> arena;
+        AstPtr<BlockNode> root;
+        std::vector<ParseError> errors;
+
+        std::vector<SymbolInfo> exports; // globals this segment declares
+        SemanticAnalyzer::SymbolTableList tables;
+        IR fragment;
+    };
+
+    // Moves a reused segment and everything in it to start on `baseLine`.
+    static void moveSegment(Segment &segment, int baseLine);
+
+    std::vector<Segment> segments;
+    SemanticAnalyzer semanticAnalyzer;
+    IR ir;
+    std::vector<ParseError> errors;
+    std::string semanticErrorMessage;
+    Stats stats;
+};
@@ -0,0 +1,184 @@
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> allocationCount{0};
+std::atomic<uint64_t> allocationBytes{0};
+std::atomic<bool> countingEnabled{false};
+
+void *countedAllocation(std::size_t size) {
+    if (countingEnabled.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (void *memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void writeJSONString(std::ostream &out, const std::string &text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+double toMilliseconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Functions by inclusive time, longest first.
+std::vector<std::pair<Symbol, ExecutionProfile::FunctionStats>> sortedFunctions(const ExecutionProfile &profile) {
+    std::vector<std::pair<Symbol, ExecutionProfile::FunctionStats>> functions(profile.functions.begin(), profile.functions.end());
+    std::sort(functions.begin(), functions.end(), [](const auto &a, const auto &b) {
+        if (a.second.inclusive != b.second.inclusive) return a.second.inclusive > b.second.inclusive;
+        return symbolName(a.first) < symbolName(b.first);
+    });
+    return functions;
+}
+
+} // namespace
+
+void *operator new(std::size_t size) { return countedAllocation(size); }
+void *operator new[](std::size_t size) { return countedAllocation(size); }
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, std::size_t) noexcept { std::free(memory); }
+
+AllocationCounters allocationCounters() {
+    return {allocationCount.load(std::memory_order_relaxed), allocationBytes.load(std::memory_order_relaxed)};
+}
+
+void setAllocationCounting(bool enabled) {
+    countingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+Instrumentation::Instrumentation(bool echo)
+    : echo(echo), start(std::chrono::steady_clock::now()), allocationsAtStart(allocationCounters()) {}
+
+void Instrumentation::lap(const std::string &phase) {
+    auto now = std::chrono::steady_clock::now();
+    AllocationCounters allocations = allocationCounters();
+
+    Phase row;
+    row.name = phase;
+    row.milliseconds = std::chrono::duration<double, std::milli>(now - start).count();
+    row.allocations = allocations.count - allocationsAtStart.count;
+    row.allocatedBytes = allocations.bytes - allocationsAtStart.bytes;
+    if (echo) {
+        std::cerr << "[time] " << phase << ": " << row.milliseconds << " ms\n";
+    }
+    rows.push_back(std::move(row));
+
+    // Restart the clock last so the bookkeeping above is not charged to the
+    // next phase.
+    allocationsAtStart = allocationCounters();
+    start = std::chrono::steady_clock::now();
+}
+
+void Instrumentation::addDetail(const std::string &name, double milliseconds) {
+    Phase row;
+    row.name = name;
+    row.milliseconds = milliseconds;
+    row.detail = true;
+    rows.push_back(std::move(row));
+}
+
+void Instrumentation::printTable(std::ostream &out) const {
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+
+    double total = 0;
+    uint64_t totalAllocations = 0, totalBytes = 0;
+    out << "\n--- Phases ---\n";
+    out << std::left << std::setw(28) << "phase" << std::right << std::setw(12) << "ms" << std::setw(14) << "allocs" << std::setw(16) << "bytes" << "\n";
+    for (const Phase &row : rows) {
+        if (row.detail) {
+            out << std::left << std::setw(28) << ("  " + row.name + " (cpu)") << std::right << std::setw(12) << row.milliseconds << "\n";
+            continue;
+        }
+        out << std::left << std::setw(28) << row.name << std::right << std::setw(12) << row.milliseconds
+            << std::setw(14) << row.allocations << std::setw(16) << row.allocatedBytes << "\n";
+        total += row.milliseconds;
+        totalAllocations += row.allocations;
+        totalBytes += row.allocatedBytes;
+    }
+    out << std::left << std::setw(28) << "total" << std::right << std::setw(12) << total
+        << std::setw(14) << totalAllocations << std::setw(16) << totalBytes << "\n";
+
+    if (profile.instructions > 0) {
+        out << "\n--- Opcodes (" << profile.instructions << " executed) ---\n";
+        std::vector<std::pair<uint64_t, size_t>> opcodes;
+        for (size_t op = 0; op < profile.opcode_counts.size(); ++op) {
+            if (profile.opcode_counts[op] > 0) {
+                opcodes.emplace_back(profile.opcode_counts[op], op);
+            }
+        }
+        std::sort(opcodes.rbegin(), opcodes.rend());
+        for (const auto &[count, op] : opcodes) {
+            out << std::left << std::setw(28) << opcodeName(static_cast<Opcode>(op)) << std::right << std::setw(14) << count
+                << std::setw(11) << 100.0 * count / profile.instructions << " %\n";
+        }
+    }
+
+    if (!profile.functions.empty()) {
+        out << "\n--- Functions ---\n";
+        out << std::left << std::setw(28) << "function" << std::right << std::setw(14) << "calls" << std::setw(16) << "inclusive ms" << std::setw(14) << "memo hits" << "\n";
+        for (const auto &[name, stats] : sortedFunctions(profile)) {
+            out << std::left << std::setw(28) << symbolName(name) << std::right << std::setw(14) << stats.calls
+                << std::setw(16) << toMilliseconds(stats.inclusive) << std::setw(14) << stats.memo_hits << "\n";
+        }
+    }
+    out.flags(flags);
+}
+
+void Instrumentation::writeJSON(std::ostream &out) const {
+    out << "{\n  \"phases\": [";
+    bool first = true;
+    for (const Phase &row : rows) {
+        out << (first ? "\n" : ",\n") << "    {\"name\": ";
+        writeJSONString(out, row.name);
+        out << ", \"ms\": " << row.milliseconds;
+        if (row.detail) {
+            out << ", \"cpu_detail\": true}";
+        } else {
+            out << ", \"allocations\": " << row.allocations << ", \"allocated_bytes\": " << row.allocatedBytes << "}";
+        }
+        first = false;
+    }
+    out << "\n  ],\n  \"instructions\": " << profile.instructions << ",\n  \"opcodes\": {";
+    first = true;
+    for (size_t op = 0; op < profile.opcode_counts.size(); ++op) {
+        if (profile.opcode_counts[op] == 0) continue;
+        out << (first ? "\n" : ",\n") << "    \"" << opcodeName(static_cast<Opcode>(op)) << "\": " << profile.opcode_counts[op];
+        first = false;
+    }
+    out << "\n  },\n  \"functions\": [";
+    first = true;
+    for (const auto &[name, stats] : sortedFunctions(profile)) {
+        out << (first ? "\n" : ",\n") << "    {\"name\": ";
+        writeJSONString(out, symbolName(name));
+        out << ", \"calls\": " << stats.calls << ", \"inclusive_ms\": " << toMilliseconds(stats.inclusive)
+            << ", \"memo_hits\": " << stats.memo_hits << "}";
+        first = false;
+    }
+    out << "\n  ]\n}\n";
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "interpreter.hpp"
+
+// Process-wide totals kept by the replacement operator new in
+// instrumentation.cpp. Counting is off until enabled, so that runs without
+// statistics do not pay for the atomic updates.
+struct AllocationCounters {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+AllocationCounters allocationCounters();
+void setAllocationCounting(bool enabled);
+
+/*
+    Collects what one run of the compiler spent where: a row per phase with
+    its wall time and the allocations made during it, plus the interpreter's
+    ExecutionProfile. Phases are closed with lap(), which charges everything
+    since the previous lap to the named phase.
+
+    Rows added with addDetail() are breakdowns of the phase before them
+    (e.g. analysis and lowering inside "compile"); they carry CPU time only
+    and are not part of the total.
+*/
+class Instrumentation {
+public:
+    struct Phase {
+        std::string name;
+        double milliseconds = 0;
+        uint64_t allocations = 0;
+        uint64_t allocatedBytes = 0;
+        bool detail = false;
+    };
+
+    // `echo` prints each phase to stderr as it is closed (--time-phases).
+    explicit Instrumentation(bool echo = false);
+
+    void lap(const std::string &phase);
+    void addDetail(const std::string &name, double milliseconds);
+
+    ExecutionProfile &execution() { return profile; }
+    const std::vector<Phase> &phases() const { return rows; }
+
+    // Human-readable tables for --stats.
+    void printTable(std::ostream &out) const;
+    // The same data as one JSON object, for tooling.
+    void writeJSON(std::ostream &out) const;
+
+private:
+    bool echo;
+    std::chrono::steady_clock::time_point start;
+    AllocationCounters allocationsAtStart;
+    std::vector<Phase> rows;
+    ExecutionProfile profile;
+};
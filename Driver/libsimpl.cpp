@@ -0,0 +1,121 @@
+#include "libsimpl.hpp"
+#include <sstream>
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "parallel_compiler.hpp"
+
+namespace simpl {
+
+struct Program::Image {
+    IR ir;
+    std::shared_ptr<const CodeIndex> code;
+
+    explicit Image(IR compiled) : ir(std::move(compiled)), code(std::make_shared<CodeIndex>(ir)) {}
+};
+
+CompileError::CompileError(std::vector<std::string> diagnostics)
+    : std::runtime_error(diagnostics.empty() ? "compilation failed" : diagnostics.front()), messages(std::move(diagnostics)) {}
+
+Program Program::compile(const std::string &source, const CompileOptions &options) {
+    Lexer lexer(source);
+    std::vector<Token> tokens;
+    Token token;
+    do {
+        token = lexer.getNextToken();
+        tokens.push_back(token);
+    } while (token.type != TokenType::END_OF_FILE);
+
+    AstArena arena;
+    Parser parser(std::move(tokens), arena);
+    ParseResult parsed = parser.parseProgram();
+    if (!parsed.ok()) {
+        std::vector<std::string> diagnostics;
+        for (const ParseError &error : parsed.errors) {
+            std::ostringstream message;
+            message << error;
+            diagnostics.push_back(message.str());
+        }
+        throw CompileError(std::move(diagnostics));
+    }
+
+    ParallelCompiler compiler(options.workers);
+    try {
+        compiler.compile(parsed.root.get());
+    } catch (const std::runtime_error &e) {
+        throw CompileError({e.what()});
+    }
+    return fromIR(compiler.getIR());
+}
+
+Program Program::fromIR(IR ir) {
+    return Program(std::make_shared<const Image>(std::move(ir)));
+}
+
+const IR &Program::ir() const {
+    return image->ir;
+}
+
+ExecutionContext::ExecutionContext()
+    : capturing(true), sink(captured, FlushPolicy::ON_EXIT, 0) {} // ON_EXIT grows the buffer as needed
+
+ExecutionContext::ExecutionContext(OutputTarget &target, FlushPolicy policy)
+    : capturing(false), sink(target, policy) {}
+
+ExecutionContext::~ExecutionContext() = default;
+
+void ExecutionContext::setLimits(const ExecutionLimits &limits) {
+    this->limits = limits;
+    if (interpreter) {
+        interpreter->set_limits(limits);
+    }
+}
+
+RunResult ExecutionContext::run(const Program &program) {
+    start(program);
+    resume({});
+    return result();
+}
+
+void ExecutionContext::setMemoization(size_t entries) {
+    memoEntries = entries;
+    if (interpreter) {
+        interpreter->set_memoization(entries);
+    }
+}
+
+void ExecutionContext::setParallelRunner(ParallelRunner *runner) {
+    parallelRunner = runner;
+    if (interpreter) {
+        interpreter->set_parallel_runner(runner);
+    }
+}
+
+void ExecutionContext::start(const Program &program) {
+    if (loaded != program.image) {
+        interpreter = std::make_unique<TACInterpreter>(program.image->ir, program.image->code, &sink);
+        loaded = program.image;
+        interpreter->set_limits(limits);
+        interpreter->set_memoization(memoEntries);
+        interpreter->set_parallel_runner(parallelRunner);
+    }
+    errors.str("");
+    interpreter->set_diagnostics(errors);
+    interpreter->start();
+}
+
+bool ExecutionContext::resume(const TimeSlice &slice) {
+    return !interpreter || interpreter->resume(slice) != ExecutionStatus::SUSPENDED;
+}
+
+RunResult ExecutionContext::result() {
+    RunResult result;
+    result.ok = interpreter && interpreter->status() == ExecutionStatus::FINISHED;
+    result.error = errors.str();
+    if (capturing) {
+        result.output = captured.contents();
+        captured.clear();
+    }
+    return result;
+}
+
+} // namespace simpl
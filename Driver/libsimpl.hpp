@@ -0,0 +1,109 @@
+#pragma once
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ir.hpp"
+#include "interpreter.hpp"
+#include "output_sink.hpp"
+
+/*
+    Embedding API. A host compiles source text into a Program once and then
+    runs it as often as it likes through ExecutionContexts:
+
+        simpl::Program program = simpl::Program::compile(source);
+        simpl::ExecutionContext context;
+        simpl::RunResult result = context.run(program);
+        // result.output holds everything the program printed
+
+    A Program is an immutable, reference-counted handle: copying it is cheap
+    and any number of threads may run the same Program at once. An
+    ExecutionContext holds the mutable interpreter state and is meant for one
+    thread at a time; give each worker its own and reuse it across runs.
+*/
+namespace simpl {
+
+struct CompileOptions {
+    unsigned workers = 1; // threads for analysis and lowering; 0 picks one per core
+};
+
+// Thrown by Program::compile. what() is the first diagnostic.
+class CompileError : public std::runtime_error {
+public:
+    explicit CompileError(std::vector<std::string> diagnostics);
+    const std::vector<std::string> &diagnostics() const { return messages; }
+
+private:
+    std::vector<std::string> messages;
+};
+
+class Program {
+public:
+    static Program compile(const std::string &source, const CompileOptions &options = {});
+
+    // Wraps IR produced elsewhere, e.g. loaded from an IRCache.
+    static Program fromIR(IR ir);
+
+    const IR &ir() const;
+
+private:
+    struct Image;
+    explicit Program(std::shared_ptr<const Image> image) : image(std::move(image)) {}
+
+    std::shared_ptr<const Image> image;
+    friend class ExecutionContext;
+};
+
+struct RunResult {
+    bool ok = false;
+    std::string output;     // what the program printed, unless it went to a host OutputTarget
+    std::string error;      // runtime error messages, if any
+};
+
+class ExecutionContext {
+public:
+    // Output is captured and returned in RunResult::output.
+    ExecutionContext();
+    // Output is streamed to `target`, which must outlive the context.
+    explicit ExecutionContext(OutputTarget &target, FlushPolicy policy = FlushPolicy::THRESHOLD);
+    ~ExecutionContext();
+
+    ExecutionContext(const ExecutionContext &) = delete;
+    ExecutionContext &operator=(const ExecutionContext &) = delete;
+
+    RunResult run(const Program &program);
+
+    // Time-sliced form of run(): start() loads `program` without running
+    // it, each resume() runs it for one slice and returns true once it has
+    // finished or failed, and result() then collects the outcome.
+    void start(const Program &program);
+    bool resume(const TimeSlice &slice);
+    RunResult result();
+
+    // Caps every later run; a run that exceeds one fails with the reason in
+    // RunResult::error. Contexts start without limits.
+    void setLimits(const ExecutionLimits &limits);
+
+    // Caches up to `entries` results of pure functions of numbers (0, the
+    // default, turns this off). The cache lives as long as the context keeps
+    // running the same Program.
+    void setMemoization(size_t entries);
+
+    // Threads for parallelSum, parallelCount and parallelMax; `runner`
+    // must outlive the context. Without one they run on the calling thread.
+    void setParallelRunner(ParallelRunner *runner);
+
+private:
+    MemoryOutputTarget captured;
+    bool capturing;
+    OutputSink sink;
+    ExecutionLimits limits;
+    size_t memoEntries = 0;
+    ParallelRunner *parallelRunner = nullptr;
+    std::ostringstream errors;
+    std::shared_ptr<const Program::Image> loaded; // program the interpreter below was built for
+    std::unique_ptr<TACInterpreter> interpreter;
+};
+
+} // namespace simpl
@@ -0,0 +1,285 @@
+#include "parallel_compiler.hpp"
+#include "ir_generator.hpp"
+#include "runner.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Runs task(0) .. task(count - 1) on the calling thread and, when there is
+// more than one task, on up to one helper per thread of `pool`.
+template <typename Task>
+void parallelFor(size_t count, simpl::WorkStealingPool *pool, const Task &task) {
+    std::atomic<size_t> next{0};
+    auto drain = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            task(i);
+        }
+    };
+
+    size_t helpers = pool && count > 1 ? std::min<size_t>(pool->size(), count - 1) : 0;
+    for (size_t t = 0; t < helpers; ++t) {
+        pool->submit([&](unsigned) { drain(); });
+    }
+    drain();
+    if (helpers) {
+        pool->wait();
+    }
+}
+
+// Records every function called under `node`. Nested function declarations
+// are flagged because they write to the global table from inside a body.
+void collectCalls(const ASTNode *node, std::vector<Symbol> &callees, bool &nestedFunction) {
+    if (!node) return;
+
+    switch (node->kind) {
+        case NodeKind::Return:
+            collectCalls(static_cast<const ReturnNode *>(node)->returnExpression.get(), callees, nestedFunction);
+            break;
+        case NodeKind::Declaration:
+            for (const auto &decl : static_cast<const DeclarationNode *>(node)->declarations) {
+                collectCalls(decl->initializer.get(), callees, nestedFunction);
+            }
+            break;
+        case NodeKind::VarDeclare:
+            collectCalls(static_cast<const VarDeclareNode *>(node)->initializer.get(), callees, nestedFunction);
+            break;
+        case NodeKind::IfStatement: {
+            auto ifNode = static_cast<const IfStatementNode *>(node);
+            for (const auto &[condition, block] : ifNode->conditionBlocks) {
+                collectCalls(condition.get(), callees, nestedFunction);
+                collectCalls(block.get(), callees, nestedFunction);
+            }
+            collectCalls(ifNode->elseBranch.get(), callees, nestedFunction);
+            break;
+        }
+        case NodeKind::Comparison: {
+            auto cmp = static_cast<const ComparisonNode *>(node);
+            collectCalls(cmp->leftExpression.get(), callees, nestedFunction);
+            collectCalls(cmp->rightExpression.get(), callees, nestedFunction);
+            break;
+        }
+        case NodeKind::LogicalExpr: {
+            auto logical = static_cast<const LogicalExprNode *>(node);
+            collectCalls(logical->leftExpression.get(), callees, nestedFunction);
+            collectCalls(logical->rightExpression.get(), callees, nestedFunction);
+            break;
+        }
+        case NodeKind::BinaryExpr: {
+            auto binary = static_cast<const BinaryExprNode *>(node);
+            collectCalls(binary->left.get(), callees, nestedFunction);
+            collectCalls(binary->right.get(), callees, nestedFunction);
+            break;
+        }
+        case NodeKind::UnaryExpr:
+            collectCalls(static_cast<const UnaryExprNode *>(node)->operand.get(), callees, nestedFunction);
+            break;
+        case NodeKind::Assignment: {
+            auto assign = static_cast<const AssignmentNode *>(node);
+            collectCalls(assign->left.get(), callees, nestedFunction);
+            collectCalls(assign->rightExpression.get(), callees, nestedFunction);
+            break;
+        }
+        case NodeKind::Print:
+            collectCalls(static_cast<const PrintNode *>(node)->expression.get(), callees, nestedFunction);
+            break;
+        case NodeKind::Function:
+            nestedFunction = true;
+            break;
+        case NodeKind::CallExpr: {
+            auto call = static_cast<const CallExprNode *>(node);
+            callees.push_back(call->functionName);
+            for (const auto &arg : call->arguments) {
+                // A bare name may be a function handed to a built-in such as
+                // parallelSum, which then has to be checked first.
+                if (auto variable = ast_cast<VariableNode>(arg.get())) {
+                    callees.push_back(variable->name);
+                }
+                collectCalls(arg.get(), callees, nestedFunction);
+            }
+            break;
+        }
+        case NodeKind::While: {
+            auto whileNode = static_cast<const WhileNode *>(node);
+            collectCalls(whileNode->conditionStatement.get(), callees, nestedFunction);
+            collectCalls(whileNode->whileBlock.get(), callees, nestedFunction);
+            break;
+        }
+        case NodeKind::Block:
+            for (const auto &stmt : static_cast<const BlockNode *>(node)->statements) {
+                collectCalls(stmt.get(), callees, nestedFunction);
+            }
+            break;
+        case NodeKind::ArrayAlloc:
+            collectCalls(static_cast<const ArrayAllocNode *>(node)->size.get(), callees, nestedFunction);
+            break;
+        case NodeKind::Index: {
+            auto index = static_cast<const IndexNode *>(node);
+            collectCalls(index->array.get(), callees, nestedFunction);
+            collectCalls(index->index.get(), callees, nestedFunction);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Adds the time `work` takes to `total`, in nanoseconds.
+template <typename Work>
+auto timed(std::atomic<int64_t> &total, Work &&work) {
+    struct Charge {
+        std::atomic<int64_t> &total;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ~Charge() {
+            total += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+    } charge{total};
+    return work();
+}
+
+} // namespace
+
+ParallelCompiler::ParallelCompiler(unsigned workers)
+    : workerCount(workers ? workers : std::max(1u, std::thread::hardware_concurrency())) {}
+
+ParallelCompiler::~ParallelCompiler() = default;
+
+void ParallelCompiler::keepBlockScopes(bool keep) {
+    keepingBlockScopes = keep;
+    semanticAnalyzer.keepBlockScopes(keep);
+}
+
+void ParallelCompiler::compile(BlockNode *program) {
+    std::atomic<int64_t> analysisNs{0};
+    std::atomic<int64_t> loweringNs{0};
+    struct Publish {
+        ParallelCompiler &compiler;
+        std::atomic<int64_t> &analysis, &lowering;
+        ~Publish() {
+            compiler.phaseTimings.analysisMs = analysis / 1e6;
+            compiler.phaseTimings.loweringMs = lowering / 1e6;
+        }
+    } publish{*this, analysisNs, loweringNs};
+
+    ir.clear();
+    semanticAnalyzer.beginProgram();
+
+    const auto &items = program->statements;
+    size_t count = items.size();
+    std::vector<std::exception_ptr> failures(count);
+    std::vector<IR> fragments(count);
+
+    // Phase one: signatures, in source order.
+    std::unordered_map<Symbol, size_t> declarationOrder;
+    std::vector<std::vector<std::pair<Type, Symbol>>> params(count);
+    std::vector<std::vector<Symbol>> callees(count);
+    std::vector<size_t> level(count, 0);
+    std::vector<std::vector<size_t>> waves;
+    bool nestedFunction = false;
+    size_t end = count;
+
+    for (size_t i = 0; i < count; ++i) {
+        auto func = ast_cast<FunctionNode>(items[i].get());
+        if (!func) continue;
+
+        try {
+            params[i] = timed(analysisNs, [&] { return semanticAnalyzer.declareFunctionSignature(func); });
+        } catch (...) {
+            failures[i] = std::current_exception();
+            end = i;
+            break;
+        }
+        declarationOrder[func->name] = i;
+        collectCalls(func->functionBlock.get(), callees[i], nestedFunction);
+
+        for (Symbol callee : callees[i]) {
+            auto found = declarationOrder.find(callee);
+            if (found != declarationOrder.end() && found->second < i) {
+                level[i] = std::max(level[i], level[found->second] + 1);
+            }
+        }
+        if (level[i] >= waves.size()) {
+            waves.resize(level[i] + 1);
+        }
+        waves[level[i]].push_back(i);
+    }
+
+    if (nestedFunction) {
+        // Bodies that declare functions mutate the shared globals; keep the
+        // plain front-to-back pass for those programs.
+        timed(analysisNs, [&] { semanticAnalyzer.analyze(program); });
+        IRGenerator irGenerator;
+        timed(loweringNs, [&] { irGenerator.generate(program); });
+        ir = irGenerator.getIR();
+        return;
+    }
+
+    // Phase two: bodies and IR, one wave at a time. Workers only read the
+    // global table; return types are written back between waves.
+    std::vector<std::unique_ptr<SemanticAnalyzer>> bodyAnalyzers(count);
+    std::vector<Type> returnTypes(count, Type::UNKNOWN);
+    if (!pool && workerCount > 1) {
+        pool = std::make_unique<simpl::WorkStealingPool>(workerCount - 1);
+    }
+
+    for (const auto &wave : waves) {
+        parallelFor(wave.size(), pool.get(), [&](size_t k) {
+            size_t i = wave[k];
+            auto func = static_cast<FunctionNode *>(items[i].get());
+            bodyAnalyzers[i] = std::make_unique<SemanticAnalyzer>();
+            bodyAnalyzers[i]->shareGlobals(semanticAnalyzer);
+            bodyAnalyzers[i]->keepBlockScopes(keepingBlockScopes);
+            bodyAnalyzers[i]->limitVisibleFunctions(&declarationOrder, i);
+            try {
+                returnTypes[i] = timed(analysisNs, [&] { return bodyAnalyzers[i]->analyzeFunctionBody(func, params[i]); });
+                IRGenerator irGenerator;
+                timed(loweringNs, [&] { irGenerator.generate(func); });
+                fragments[i] = irGenerator.getIR();
+            } catch (...) {
+                failures[i] = std::current_exception();
+            }
+        });
+        for (size_t i : wave) {
+            if (!failures[i]) {
+                auto func = static_cast<FunctionNode *>(items[i].get());
+                semanticAnalyzer.setFunctionReturnType(func->name, returnTypes[i]);
+                semanticAnalyzer.setFunctionPurity(func->name, func->pure);
+            }
+        }
+    }
+
+    // Top-level statements run last, in order, and see every function
+    // declared before them.
+    for (size_t i = 0; i < end; ++i) {
+        if (bodyAnalyzers[i]) {
+            semanticAnalyzer.adoptSymbolTables(bodyAnalyzers[i]->symbolTablesSince(0));
+            continue;
+        }
+        semanticAnalyzer.limitVisibleFunctions(&declarationOrder, i);
+        try {
+            timed(analysisNs, [&] { semanticAnalyzer.analyzeStatement(items[i].get()); });
+            IRGenerator irGenerator;
+            timed(loweringNs, [&] { irGenerator.generate(items[i].get()); });
+            fragments[i] = irGenerator.getIR();
+        } catch (...) {
+            failures[i] = std::current_exception();
+            break;
+        }
+    }
+    semanticAnalyzer.limitVisibleFunctions(nullptr, 0);
+
+    for (const auto &failure : failures) {
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+    for (const IR &fragment : fragments) {
+        ir.append(fragment);
+    }
+}
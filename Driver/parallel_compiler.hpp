@@ -0,0 +1,57 @@
+#pragma once
+#include <memory>
+#include "ast.hpp"
+#include "ir.hpp"
+#include "semantic_analyzer.hpp"
+
+namespace simpl {
+class WorkStealingPool;
+}
+
+/*
+    Two-phase replacement for running SemanticAnalyzer::analyze and
+    IRGenerator::generate over the whole program.
+
+    Phase one walks the top-level functions in order and enters their
+    signatures into the global table. Phase two checks each function body
+    and generates its IR on a pool of worker threads. A body only depends on
+    the return types of the functions it calls, which must be declared
+    before it, so functions are scheduled in waves: a function runs once
+    everything it calls has finished. Top-level statements outside functions
+    are analyzed last, on the calling thread. The worker threads are started
+    on the first compile() and reused by every later wave and compile().
+
+    Every top-level item gets its own IR fragment (labels and temporaries
+    numbered from zero), and the fragments are linked in source order. When
+    several items fail, the error of the earliest one is rethrown, which is
+    the error a front-to-back pass would have stopped at.
+*/
+class ParallelCompiler {
+public:
+    // Time spent in each phase of the last compile(), summed over workers,
+    // so with several threads it can exceed the wall time.
+    struct Timings {
+        double analysisMs = 0;
+        double loweringMs = 0;
+    };
+
+    explicit ParallelCompiler(unsigned workers = 0); // 0 picks one per core
+    ~ParallelCompiler();
+
+    // Throws std::runtime_error on semantic errors, like SemanticAnalyzer::analyze.
+    void compile(BlockNode *program);
+
+    const SemanticAnalyzer &analyzer() const { return semanticAnalyzer; }
+    // See SemanticAnalyzer::keepBlockScopes; applies to every later compile().
+    void keepBlockScopes(bool keep);
+    const IR &getIR() const { return ir; }
+    const Timings &timings() const { return phaseTimings; }
+
+private:
+    unsigned workerCount;
+    bool keepingBlockScopes = false;
+    std::unique_ptr<simpl::WorkStealingPool> pool; // workerCount - 1 threads; the caller is the last worker
+    Timings phaseTimings;
+    SemanticAnalyzer semanticAnalyzer;
+    IR ir;
+};
@@ -0,0 +1,168 @@
+#include "runner.hpp"
+#include <algorithm>
+
+namespace simpl {
+
+WorkStealingPool::WorkStealingPool(unsigned workers) {
+    unsigned count = workers ? workers : std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < count; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    // Spread submissions round-robin; stealing evens out the rest.
+    Queue &queue = *queues[nextQueue++ % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        queued++;
+        unfinished++;
+    }
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::post(std::function<void()> job) {
+    submit([job = std::move(job)](unsigned) { job(); });
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return unfinished == 0; });
+}
+
+bool WorkStealingPool::take(unsigned self, Task &task) {
+    {
+        Queue &own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        Queue &victim = *queues[(self + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(unsigned self) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            workAvailable.wait(lock, [this] { return queued > 0 || stopping; });
+            if (queued == 0) {
+                return; // stopping, and nothing left to do
+            }
+            queued--; // claim one task; it is guaranteed to be in some deque
+        }
+
+        Task task;
+        while (!take(self, task)) {
+            std::this_thread::yield(); // lost a race for a task we saw; our claim guarantees another
+        }
+        task(self);
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (--unfinished == 0) {
+            allDone.notify_all();
+        }
+    }
+}
+
+BatchRunner::BatchRunner(WorkStealingPool &pool) : pool(pool) {
+    for (unsigned i = 0; i < pool.size(); ++i) {
+        contexts.push_back(std::make_unique<ExecutionContext>());
+        contexts.back()->setParallelRunner(&pool);
+    }
+}
+
+void BatchRunner::setLimits(const ExecutionLimits &limits) {
+    for (auto &context : contexts) {
+        context->setLimits(limits);
+    }
+}
+
+std::vector<RunResult> BatchRunner::run(const std::vector<Program> &programs) {
+    std::vector<RunResult> results(programs.size());
+    for (size_t i = 0; i < programs.size(); ++i) {
+        pool.submit([this, &programs, &results, i](unsigned worker) {
+            results[i] = contexts[worker]->run(programs[i]);
+        });
+    }
+    pool.wait();
+    return results;
+}
+
+std::vector<RunResult> BatchRunner::run(const Program &program, size_t count) {
+    std::vector<RunResult> results(count);
+    for (size_t i = 0; i < count; ++i) {
+        pool.submit([this, &program, &results, i](unsigned worker) {
+            results[i] = contexts[worker]->run(program);
+        });
+    }
+    pool.wait();
+    return results;
+}
+
+RoundRobinScheduler::RoundRobinScheduler(TimeSlice slice) : slice(slice) {}
+
+size_t RoundRobinScheduler::add(const Program &program) {
+    programs.push_back(program);
+    return programs.size() - 1;
+}
+
+void RoundRobinScheduler::setLimits(const ExecutionLimits &limits) {
+    this->limits = limits;
+}
+
+std::vector<RunResult> RoundRobinScheduler::runAll() {
+    std::vector<RunResult> results(programs.size());
+    std::vector<std::unique_ptr<ExecutionContext>> contexts(programs.size());
+    std::deque<size_t> ready;
+    for (size_t i = 0; i < programs.size(); ++i) {
+        contexts[i] = std::make_unique<ExecutionContext>();
+        contexts[i]->setLimits(limits);
+        contexts[i]->start(programs[i]);
+        ready.push_back(i);
+    }
+
+    while (!ready.empty()) {
+        size_t i = ready.front();
+        ready.pop_front();
+        if (contexts[i]->resume(slice)) {
+            results[i] = contexts[i]->result();
+            contexts[i].reset(); // frees its frames and buffers right away
+        } else {
+            ready.push_back(i);
+        }
+    }
+    programs.clear();
+    return results;
+}
+
+} // namespace simpl
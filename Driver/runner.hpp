@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "libsimpl.hpp"
+
+namespace simpl {
+
+/*
+    Fixed set of worker threads, each with its own task deque. A worker
+    takes new work from the back of its own deque and, when that is empty,
+    steals from the front of the others', so a batch of uneven tasks
+    spreads itself over the pool without a central queue. Tasks are told
+    which worker runs them, which lets callers keep per-worker state.
+*/
+class WorkStealingPool : public ParallelRunner {
+public:
+    using Task = std::function<void(unsigned worker)>;
+
+    explicit WorkStealingPool(unsigned workers = 0); // 0 picks one per core
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    void submit(Task task);
+    // Blocks until every task submitted so far has finished.
+    void wait();
+
+    unsigned size() const { return static_cast<unsigned>(threads.size()); }
+
+    // ParallelRunner, for interpreters that spread parallelSum and the
+    // like over the pool.
+    unsigned concurrency() const override { return size(); }
+    void post(std::function<void()> job) override;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool take(unsigned self, Task &task);
+    void workerLoop(unsigned self);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<unsigned> nextQueue{0};
+
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    size_t queued = 0;      // submitted, not yet taken
+    size_t unfinished = 0;  // submitted, not yet finished
+    bool stopping = false;
+};
+
+/*
+    Runs many program instances at once on `pool`. Every worker keeps one
+    ExecutionContext, so an instance gets its own frames and output buffer
+    while the compiled IR is shared by all instances of a Program. Their
+    parallelSum and the like use idle workers of the same pool.
+*/
+class BatchRunner {
+public:
+    explicit BatchRunner(WorkStealingPool &pool);
+
+    // results[i] is the run of programs[i].
+    std::vector<RunResult> run(const std::vector<Program> &programs);
+
+    // `count` independent runs of one program.
+    std::vector<RunResult> run(const Program &program, size_t count);
+
+    // Applied to every worker's context.
+    void setLimits(const ExecutionLimits &limits);
+
+private:
+    WorkStealingPool &pool;
+    std::vector<std::unique_ptr<ExecutionContext>> contexts; // one per worker
+};
+
+/*
+    Runs many program instances on the calling thread by time-slicing them:
+    each unfinished instance in turn runs for one TimeSlice and goes to the
+    back of the queue, so a long-running instance delays short ones by at
+    most a slice per round instead of its whole running time. Every instance
+    has its own ExecutionContext; the compiled IR is shared.
+*/
+class RoundRobinScheduler {
+public:
+    explicit RoundRobinScheduler(TimeSlice slice);
+
+    // Queues one instance of `program`; returns its index in runAll().
+    size_t add(const Program &program);
+
+    void setLimits(const ExecutionLimits &limits);
+
+    // Runs every queued instance to completion and empties the queue.
+    // results[i] is the run of the instance add() numbered i.
+    std::vector<RunResult> runAll();
+
+private:
+    TimeSlice slice;
+    ExecutionLimits limits;
+    std::vector<Program> programs;
+};
+
+} // namespace simpl
@@ -1,23 +1,185 @@
-
 #pragma once
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <vector>
+#include "../Lexer/interner.hpp"
+
+/*
+    An operand of a three-address instruction. Names and string constants are
+    carried as interned Symbols, temporaries and labels as plain indices, so
+    nothing downstream of the IR generator has to parse or hash operand text.
+*/
+struct IROperand {
+    enum class Kind {
+        NONE,
+        NUMBER,  // integer constant, stored in `number`
+        STRING,  // string constant, contents interned in `symbol`
+        NAME,    // variable or function name, interned in `symbol`; a variable's frame slot is in `number`
+        TEMP,    // compiler temporary t<number>
+        LABEL,   // jump target L<number>
+        RETVAL   // value of the last returned call
+    };
+
+    Kind kind = Kind::NONE;
+    long long number = 0;
+    Symbol symbol = 0;
+
+    IROperand() = default;
+
+    static IROperand constant(long long value) { return {Kind::NUMBER, value, 0}; }
+    static IROperand string(Symbol text) { return {Kind::STRING, 0, text}; }
+    static IROperand name(Symbol id, long long slot = -1) { return {Kind::NAME, slot, id}; }
+    static IROperand temp(long long index) { return {Kind::TEMP, index, 0}; }
+    static IROperand label(long long index) { return {Kind::LABEL, index, 0}; }
+    static IROperand retval() { return {Kind::RETVAL, 0, 0}; }
+
+    bool empty() const { return kind == Kind::NONE; }
+    bool operator==(const IROperand& other) const {
+        return kind == other.kind && number == other.number && symbol == other.symbol;
+    }
+
+    std::string toString() const {
+        switch (kind) {
+            case Kind::NUMBER: return std::to_string(number);
+            case Kind::STRING: return "\"" + symbolName(symbol) + "\"";
+            case Kind::NAME: return symbolName(symbol);
+            case Kind::TEMP: return "t" + std::to_string(number);
+            case Kind::LABEL: return "L" + std::to_string(number);
+            case Kind::RETVAL: return "retval";
+            default: return "";
+        }
+    }
+
+private:
+    IROperand(Kind kind, long long number, Symbol symbol) : kind(kind), number(number), symbol(symbol) {}
+};
+
+/*
+    Three-address opcodes. The plain arithmetic and comparison forms check
+    operand types at run time; the _i64 and _str forms are emitted when the
+    semantic analyzer has proven the operand types, and trust them.
+
+    Arrays: alloc_arr size -> result, len array -> result, load_idx array
+    index -> result and store_idx array index value, the value going in the
+    result operand. Loads and stores do not check the index themselves; a
+    check_idx array index ahead of them does, so a check can be dropped or
+    moved out of a loop without touching the access it guards.
+
+    Reductions: parallel_sum f -> result, and likewise parallel_count and
+    parallel_max, take lo and hi from the two `arg`s before them, call the
+    pure function f (a name operand) on every number in [lo, hi) and
+    combine the results, possibly on several threads.
+*/
+enum class Opcode {
+    VAR, ASSIGN, MOVE, PRINT,
+    LABEL, GOTO, IFZ_GOTO,
+    FUNC_START, FUNC_END, PARAM, ARG, CALL, RET,
+    ADD, SUB, MUL, DIV, NEG,
+    EQ, NEQ, LT, LE, GT, GE,
+    AND, OR, NOT,
+    ADD_I64, SUB_I64, MUL_I64, DIV_I64, NEG_I64,
+    EQ_I64, NEQ_I64, LT_I64, LE_I64, GT_I64, GE_I64,
+    EQ_STR, NEQ_STR, CONCAT_STR,
+    ALLOC_ARR, CHECK_IDX, LOAD_IDX, STORE_IDX, LEN,
+    PARALLEL_SUM, PARALLEL_COUNT, PARALLEL_MAX,
+    UNKNOWN
+};
+
+// Flags in the result operand of FUNC_START (otherwise empty).
+constexpr long long FUNC_MEMOIZABLE = 1; // result depends only on the number arguments
+
+inline const char* opcodeName(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::VAR: return "var";
+        case Opcode::ASSIGN: return "assign";
+        case Opcode::MOVE: return "move";
+        case Opcode::PRINT: return "print";
+        case Opcode::LABEL: return "label";
+        case Opcode::GOTO: return "goto";
+        case Opcode::IFZ_GOTO: return "ifz_goto";
+        case Opcode::FUNC_START: return "func_start";
+        case Opcode::FUNC_END: return "func_end";
+        case Opcode::PARAM: return "param";
+        case Opcode::ARG: return "arg";
+        case Opcode::CALL: return "call";
+        case Opcode::RET: return "ret";
+        case Opcode::ADD: return "add";
+        case Opcode::SUB: return "sub";
+        case Opcode::MUL: return "mul";
+        case Opcode::DIV: return "div";
+        case Opcode::NEG: return "neg";
+        case Opcode::EQ: return "eq";
+        case Opcode::NEQ: return "neq";
+        case Opcode::LT: return "lt";
+        case Opcode::LE: return "le";
+        case Opcode::GT: return "gt";
+        case Opcode::GE: return "ge";
+        case Opcode::AND: return "and";
+        case Opcode::OR: return "or";
+        case Opcode::NOT: return "not";
+        case Opcode::ADD_I64: return "add_i64";
+        case Opcode::SUB_I64: return "sub_i64";
+        case Opcode::MUL_I64: return "mul_i64";
+        case Opcode::DIV_I64: return "div_i64";
+        case Opcode::NEG_I64: return "neg_i64";
+        case Opcode::EQ_I64: return "eq_i64";
+        case Opcode::NEQ_I64: return "neq_i64";
+        case Opcode::LT_I64: return "lt_i64";
+        case Opcode::LE_I64: return "le_i64";
+        case Opcode::GT_I64: return "gt_i64";
+        case Opcode::GE_I64: return "ge_i64";
+        case Opcode::EQ_STR: return "eq_str";
+        case Opcode::NEQ_STR: return "neq_str";
+        case Opcode::CONCAT_STR: return "concat_str";
+        case Opcode::ALLOC_ARR: return "alloc_arr";
+        case Opcode::CHECK_IDX: return "check_idx";
+        case Opcode::LOAD_IDX: return "load_idx";
+        case Opcode::STORE_IDX: return "store_idx";
+        case Opcode::LEN: return "len";
+        case Opcode::PARALLEL_SUM: return "parallel_sum";
+        case Opcode::PARALLEL_COUNT: return "parallel_count";
+        case Opcode::PARALLEL_MAX: return "parallel_max";
+        default: return "unknown";
+    }
+}
 
 struct IRInstruction {
-    std::string opcode;
-    std::string arg1;
-    std::string arg2;
-    std::string result;
+    Opcode opcode = Opcode::UNKNOWN;
+    IROperand arg1;
+    IROperand arg2;
+    IROperand result;
 
     IRInstruction() = default;
 
-    IRInstruction(std::string opcode, std::string arg1 = "", std::string arg2 = "", std::string result = "")
-        : opcode(std::move(opcode)), arg1(std::move(arg1)), arg2(std::move(arg2)), result(std::move(result)) {}
+    IRInstruction(Opcode opcode, IROperand arg1 = {}, IROperand arg2 = {}, IROperand result = {})
+        : opcode(opcode), arg1(arg1), arg2(arg2), result(result) {}
+};
+
+// Position in the source text; lines count from 0 like the lexer's.
+struct SourceLocation {
+    int line = -1;
+    int col = -1;
+
+    bool known() const { return line >= 0; }
+    bool operator==(const SourceLocation& other) const { return line == other.line && col == other.col; }
+    bool operator!=(const SourceLocation& other) const { return !(*this == other); }
+};
+
+// Instructions from `first` up to the next entry come from `location`.
+struct LocationEntry {
+    uint32_t first;
+    SourceLocation location;
 };
 
 class IR {
 public:
     std::vector<IRInstruction> instructions;
+    long long labelCount = 0; // labels L0 .. L<labelCount-1> are in use
+
+    // Source positions, run-length encoded against `instructions` so that
+    // IRInstruction stays as small as the interpreter wants it.
+    std::vector<LocationEntry> locations;
 
     void add(const IRInstruction& instr) {
         instructions.push_back(instr);
@@ -25,15 +187,62 @@ public:
 
     void clear() {
         instructions.clear();
+        labelCount = 0;
+        locations.clear();
+    }
+
+    // Attributes the instructions added from now on to `location`.
+    void setLocation(SourceLocation location) {
+        addLocation(static_cast<uint32_t>(instructions.size()), location);
+    }
+
+    SourceLocation currentLocation() const {
+        return locations.empty() ? SourceLocation{} : locations.back().location;
+    }
+
+    SourceLocation locationOf(size_t index) const {
+        auto after = std::upper_bound(locations.begin(), locations.end(), index,
+            [](size_t i, const LocationEntry& entry) { return i < entry.first; });
+        return after == locations.begin() ? SourceLocation{} : std::prev(after)->location;
+    }
+
+    // Links a separately generated fragment onto the end of this IR. The
+    // fragment's labels are renumbered past ours; temporaries are left alone
+    // since they never live across statements.
+    void append(const IR& fragment) {
+        uint32_t offset = static_cast<uint32_t>(instructions.size());
+        setLocation({});
+        for (const LocationEntry& entry : fragment.locations) {
+            addLocation(offset + entry.first, entry.location);
+        }
+        for (IRInstruction instr : fragment.instructions) {
+            for (IROperand* operand : {&instr.arg1, &instr.arg2, &instr.result}) {
+                if (operand->kind == IROperand::Kind::LABEL) {
+                    operand->number += labelCount;
+                }
+            }
+            instructions.push_back(instr);
+        }
+        labelCount += fragment.labelCount;
     }
 
     void print() const {
         for (const auto& instr : instructions) {
             printf("%s %s %s %s\n",
-                instr.opcode.c_str(),
-                instr.arg1.c_str(),
-                instr.arg2.c_str(),
-                instr.result.c_str());
+                opcodeName(instr.opcode),
+                instr.arg1.toString().c_str(),
+                instr.arg2.toString().c_str(),
+                instr.result.toString().c_str());
         }
     }
-};
\ No newline at end of file
+
+private:
+    void addLocation(uint32_t first, SourceLocation location) {
+        if (!locations.empty() && locations.back().first == first) {
+            locations.pop_back(); // nothing was emitted at the previous position
+        }
+        if (locations.empty() ? location.known() : locations.back().location != location) {
+            locations.push_back({first, location});
+        }
+    }
+};
@@ -0,0 +1,275 @@
+#include "ir_cache.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char IR_MAGIC[8] = {'S', 'I', 'M', 'P', 'L', 'I', 'R', '\0'};
+
+struct IRFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t sourceHash;
+    uint64_t optionsHash;
+    uint64_t checksum;
+    uint64_t labelCount;
+    uint32_t instructionCount;
+    uint32_t stringCount;
+    uint32_t stringBytes;
+    uint32_t locationCount;
+};
+
+struct PackedOperand {
+    uint32_t kind;
+    uint32_t string; // string table index for NAME and STRING operands
+    int64_t number;
+};
+
+struct PackedInstruction {
+    uint32_t opcode;
+    uint32_t reserved;
+    PackedOperand operands[3];
+};
+
+struct PackedLocation {
+    uint32_t first;
+    int32_t line;
+    int32_t col;
+};
+
+static_assert(sizeof(IRFileHeader) == 64, "IR file header layout changed");
+static_assert(sizeof(PackedLocation) == 12, "IR location layout changed");
+static_assert(sizeof(PackedInstruction) == 56, "IR instruction layout changed");
+
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 1469598103934665603ull) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool usesStringTable(IROperand::Kind kind) {
+    return kind == IROperand::Kind::NAME || kind == IROperand::Kind::STRING;
+}
+
+// Read-only view of a whole file, mapped where the platform allows it.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                bytes = static_cast<const char *>(mapping);
+                length = static_cast<size_t>(info.st_size);
+                mapped = true;
+            }
+        }
+        ::close(fd);
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return;
+        buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        bytes = buffer.data();
+        length = buffer.size();
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapped) {
+            ::munmap(const_cast<char *>(bytes), length);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const char *bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::vector<char> buffer;
+};
+
+} // namespace
+
+bool writeIRFile(const std::string &path, const IR &ir, uint64_t sourceHash, uint64_t optionsHash) {
+    std::vector<PackedInstruction> instructions;
+    instructions.reserve(ir.instructions.size());
+    std::unordered_map<Symbol, uint32_t> stringIndex;
+    std::vector<uint32_t> offsets{0};
+    std::string strings;
+
+    auto pack = [&](const IROperand &operand) {
+        PackedOperand packed{static_cast<uint32_t>(operand.kind), 0, operand.number};
+        if (usesStringTable(operand.kind)) {
+            auto [it, inserted] = stringIndex.emplace(operand.symbol, static_cast<uint32_t>(offsets.size() - 1));
+            if (inserted) {
+                strings += symbolName(operand.symbol);
+                offsets.push_back(static_cast<uint32_t>(strings.size()));
+            }
+            packed.string = it->second;
+        }
+        return packed;
+    };
+
+    for (const IRInstruction &instr : ir.instructions) {
+        instructions.push_back({static_cast<uint32_t>(instr.opcode), 0, {pack(instr.arg1), pack(instr.arg2), pack(instr.result)}});
+    }
+    std::vector<PackedLocation> locations;
+    locations.reserve(ir.locations.size());
+    for (const LocationEntry &entry : ir.locations) {
+        locations.push_back({entry.first, entry.location.line, entry.location.col});
+    }
+
+    IRFileHeader header{};
+    std::memcpy(header.magic, IR_MAGIC, sizeof(IR_MAGIC));
+    header.version = IR_FORMAT_VERSION;
+    header.headerSize = sizeof(IRFileHeader);
+    header.sourceHash = sourceHash;
+    header.optionsHash = optionsHash;
+    header.labelCount = static_cast<uint64_t>(ir.labelCount);
+    header.instructionCount = static_cast<uint32_t>(instructions.size());
+    header.stringCount = static_cast<uint32_t>(offsets.size() - 1);
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+    header.locationCount = static_cast<uint32_t>(locations.size());
+
+    uint64_t checksum = fnv1a(instructions.data(), instructions.size() * sizeof(PackedInstruction));
+    checksum = fnv1a(locations.data(), locations.size() * sizeof(PackedLocation), checksum);
+    checksum = fnv1a(offsets.data(), offsets.size() * sizeof(uint32_t), checksum);
+    header.checksum = fnv1a(strings.data(), strings.size(), checksum);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(instructions.data()), instructions.size() * sizeof(PackedInstruction));
+    out.write(reinterpret_cast<const char *>(locations.data()), locations.size() * sizeof(PackedLocation));
+    out.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint32_t));
+    out.write(strings.data(), strings.size());
+    return static_cast<bool>(out);
+}
+
+bool readIRFile(const std::string &path, uint64_t sourceHash, uint64_t optionsHash, IR &ir) {
+    MappedFile file(path);
+    if (file.size() < sizeof(IRFileHeader)) return false;
+
+    IRFileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, IR_MAGIC, sizeof(IR_MAGIC)) != 0 || header.version != IR_FORMAT_VERSION ||
+        header.headerSize != sizeof(IRFileHeader) || header.sourceHash != sourceHash || header.optionsHash != optionsHash) {
+        return false;
+    }
+
+    size_t instructionBytes = size_t(header.instructionCount) * sizeof(PackedInstruction);
+    size_t locationBytes = size_t(header.locationCount) * sizeof(PackedLocation);
+    size_t offsetBytes = (size_t(header.stringCount) + 1) * sizeof(uint32_t);
+    if (file.size() != sizeof(IRFileHeader) + instructionBytes + locationBytes + offsetBytes + header.stringBytes) return false;
+
+    const char *payload = file.data() + sizeof(IRFileHeader);
+    if (fnv1a(payload, file.size() - sizeof(IRFileHeader)) != header.checksum) return false;
+
+    const auto *packed = reinterpret_cast<const PackedInstruction *>(payload);
+    const auto *locations = reinterpret_cast<const PackedLocation *>(payload + instructionBytes);
+    const auto *offsets = reinterpret_cast<const uint32_t *>(payload + instructionBytes + locationBytes);
+    const char *strings = payload + instructionBytes + locationBytes + offsetBytes;
+
+    std::vector<Symbol> symbols(header.stringCount);
+    for (uint32_t i = 0; i < header.stringCount; ++i) {
+        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > header.stringBytes) return false;
+        symbols[i] = intern(std::string_view(strings + offsets[i], offsets[i + 1] - offsets[i]));
+    }
+
+    auto unpack = [&](const PackedOperand &operand, IROperand &out) {
+        auto kind = static_cast<IROperand::Kind>(operand.kind);
+        switch (kind) {
+            case IROperand::Kind::NONE: out = IROperand(); return true;
+            case IROperand::Kind::NUMBER: out = IROperand::constant(operand.number); return true;
+            case IROperand::Kind::TEMP: out = IROperand::temp(operand.number); return true;
+            case IROperand::Kind::LABEL: out = IROperand::label(operand.number); return true;
+            case IROperand::Kind::RETVAL: out = IROperand::retval(); return true;
+            case IROperand::Kind::STRING:
+            case IROperand::Kind::NAME:
+                if (operand.string >= symbols.size()) return false;
+                out = kind == IROperand::Kind::STRING ? IROperand::string(symbols[operand.string])
+                                                      : IROperand::name(symbols[operand.string], operand.number);
+                return true;
+        }
+        return false;
+    };
+
+    IR loaded;
+    loaded.instructions.resize(header.instructionCount);
+    for (uint32_t i = 0; i < header.instructionCount; ++i) {
+        IRInstruction &instr = loaded.instructions[i];
+        if (packed[i].opcode > static_cast<uint32_t>(Opcode::UNKNOWN)) return false;
+        instr.opcode = static_cast<Opcode>(packed[i].opcode);
+        if (!unpack(packed[i].operands[0], instr.arg1) || !unpack(packed[i].operands[1], instr.arg2) ||
+            !unpack(packed[i].operands[2], instr.result)) {
+            return false;
+        }
+    }
+    loaded.labelCount = static_cast<long long>(header.labelCount);
+    loaded.locations.resize(header.locationCount);
+    for (uint32_t i = 0; i < header.locationCount; ++i) {
+        loaded.locations[i] = {locations[i].first, {locations[i].line, locations[i].col}};
+    }
+    ir = std::move(loaded);
+    return true;
+}
+
+uint64_t IRCache::hashSource(const std::string &source) {
+    return fnv1a(source.data(), source.size());
+}
+
+std::string IRCache::pathFor(uint64_t sourceHash, uint64_t optionsHash) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%016llx.v%u.sir", (unsigned long long)sourceHash,
+                  (unsigned long long)optionsHash, IR_FORMAT_VERSION);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+bool IRCache::load(uint64_t sourceHash, uint64_t optionsHash, IR &ir) const {
+    return readIRFile(pathFor(sourceHash, optionsHash), sourceHash, optionsHash, ir);
+}
+
+bool IRCache::store(uint64_t sourceHash, uint64_t optionsHash, const IR &ir) const {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) return false;
+
+    std::string path = pathFor(sourceHash, optionsHash);
+    std::string temporary = path + ".tmp" + std::to_string(std::random_device{}());
+    if (!writeIRFile(temporary, ir, sourceHash, optionsHash)) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "ir.hpp"
+
+/*
+    Binary IR files. Layout, all in native byte order (cache files are not
+    meant to move between machines):
+
+        IRFileHeader                     64 bytes
+        PackedInstruction[count]         56 bytes each, 8-byte aligned
+        PackedLocation[locationCount]    12 bytes each, the IR's line table
+        uint32_t stringOffsets[n + 1]    into the string blob
+        char strings[]                   names and string constants
+
+    Operands refer to names and string constants by their index in the
+    string table, since Symbol ids are only meaningful inside one process.
+    The header carries a format version and a checksum of everything after
+    it; a file that fails either check is treated as a miss.
+*/
+constexpr uint32_t IR_FORMAT_VERSION = 5;
+
+bool writeIRFile(const std::string &path, const IR &ir, uint64_t sourceHash, uint64_t optionsHash);
+
+// Maps `path` and decodes it into `ir`. Returns false when the file is
+// missing, damaged, from another format version or for another key.
+bool readIRFile(const std::string &path, uint64_t sourceHash, uint64_t optionsHash, IR &ir);
+
+/*
+    On-disk cache of compiled programs, one file per (source, options) pair.
+    Writes go through a temporary file and a rename, so concurrent runs never
+    see a half-written entry.
+*/
+class IRCache {
+public:
+    explicit IRCache(std::string directory) : directory(std::move(directory)) {}
+
+    static uint64_t hashSource(const std::string &source);
+
+    bool load(uint64_t sourceHash, uint64_t optionsHash, IR &ir) const;
+    bool store(uint64_t sourceHash, uint64_t optionsHash, const IR &ir) const;
+
+    std::string pathFor(uint64_t sourceHash, uint64_t optionsHash) const;
+
+private:
+    std::string directory;
+};
@@ -2,182 +2,353 @@
 #include "ast.hpp"
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 
-std::string IRGenerator::newLabel() {
-    return "L" + std::to_string(labelCounter++);
+namespace {
+
+// Where `node` starts in the source; blocks carry no position of their own.
+SourceLocation sourceLocation(const ASTNode* node) {
+    switch (node->kind) {
+        case NodeKind::Return: { auto* n = static_cast<const ReturnNode*>(node); return {n->line, n->col}; }
+        case NodeKind::Variable: { auto* n = static_cast<const VariableNode*>(node); return {n->line, n->col}; }
+        case NodeKind::NumberLiteral: { auto* n = static_cast<const NumberLiteralNode*>(node); return {n->line, n->col}; }
+        case NodeKind::StringLiteral: { auto* n = static_cast<const StringLiteralNode*>(node); return {n->line, n->col}; }
+        case NodeKind::IfStatement: { auto* n = static_cast<const IfStatementNode*>(node); return {n->line, n->col}; }
+        case NodeKind::Comparison: { auto* n = static_cast<const ComparisonNode*>(node); return {n->line, n->col}; }
+        case NodeKind::LogicalExpr: { auto* n = static_cast<const LogicalExprNode*>(node); return {n->line, n->col}; }
+        case NodeKind::BinaryExpr: { auto* n = static_cast<const BinaryExprNode*>(node); return {n->line, n->col}; }
+        case NodeKind::UnaryExpr: { auto* n = static_cast<const UnaryExprNode*>(node); return {n->line, n->col}; }
+        case NodeKind::Assignment: { auto* n = static_cast<const AssignmentNode*>(node); return {n->line, n->col}; }
+        case NodeKind::Print: { auto* n = static_cast<const PrintNode*>(node); return {n->line, n->col}; }
+        case NodeKind::Function: { auto* n = static_cast<const FunctionNode*>(node); return {n->line, n->col}; }
+        case NodeKind::CallExpr: { auto* n = static_cast<const CallExprNode*>(node); return {n->line, n->col}; }
+        case NodeKind::While: { auto* n = static_cast<const WhileNode*>(node); return {n->line, n->col}; }
+        case NodeKind::ArrayAlloc: { auto* n = static_cast<const ArrayAllocNode*>(node); return {n->line, n->col}; }
+        case NodeKind::Index: { auto* n = static_cast<const IndexNode*>(node); return {n->line, n->col}; }
+        case NodeKind::VarDeclare: {
+            auto* n = static_cast<const VarDeclareNode*>(node);
+            return {n->name.line, n->name.column};
+        }
+        case NodeKind::Declaration: {
+            auto* n = static_cast<const DeclarationNode*>(node);
+            return n->declarations.empty() ? SourceLocation{} : sourceLocation(n->declarations.front().get());
+        }
+        default:
+            return {};
+    }
 }
 
-std::string IRGenerator::newTemp() {
-    return "t" + std::to_string(tempVarCounter++);
+// Attributes what is emitted for `node` to its position, then hands the
+// position back to the enclosing node.
+class LocationScope {
+public:
+    LocationScope(IR& ir, const ASTNode* node) : ir(ir), enclosing(ir.currentLocation()) {
+        SourceLocation location = sourceLocation(node);
+        if (location.known()) {
+            ir.setLocation(location);
+        }
+    }
+    ~LocationScope() { ir.setLocation(enclosing); }
+
+private:
+    IR& ir;
+    SourceLocation enclosing;
+};
+
+} // namespace
+
+IROperand IRGenerator::newLabel() {
+    ir.labelCount = labelCounter + 1;
+    return IROperand::label(labelCounter++);
+}
+
+IROperand IRGenerator::newTemp() {
+    return IROperand::temp(tempVarCounter++);
 }
 
 const IR& IRGenerator::getIR() const {
     return ir;
 }
 
+void IRGenerator::checkIndex(const IROperand& array, const IROperand& index) {
+    std::pair<IROperand, IROperand> access{array, index};
+    if (std::find(checkedIndices.begin(), checkedIndices.end(), access) != checkedIndices.end()) {
+        return;
+    }
+    checkedIndices.push_back(access);
+    ir.add({Opcode::CHECK_IDX, array, index});
+}
+
 void IRGenerator::generate(ASTNode* node) {
     if (!node) return;
+    LocationScope location(ir, node);
+    checkedIndices.clear();
 
-    if (auto* retNode = dynamic_cast<ReturnNode*>(node)) {
-        std::string val = generateExpression(retNode->returnExpression.get());
-        ir.add({"ret", val});
-    } 
-    else if (auto* declNode = dynamic_cast<DeclarationNode*>(node)) {
-        for (auto& varDecl : declNode->declarations) {
-            std::string varName = varDecl->name.value;
-            std::string initVal = varDecl->initializer ? generateExpression(varDecl->initializer.get()) : "0";
-            ir.add({"var", varName});  
-            ir.add({"assign", varName, initVal});
+    switch (node->kind) {
+        case NodeKind::Return: {
+            auto* retNode = static_cast<ReturnNode*>(node);
+            IROperand val = generateExpression(retNode->returnExpression.get());
+            ir.add({Opcode::RET, val});
+            break;
         }
-    }
-    else if (auto* assignNode = dynamic_cast<AssignmentNode*>(node)) {
-        std::string lhs = dynamic_cast<VariableNode*>(assignNode->left.get())->name;
-        std::string rhs = generateExpression(assignNode->rightExpression.get());
-        ir.add({"assign", lhs, rhs}); 
-    }
-    else if (auto* printNode = dynamic_cast<PrintNode*>(node)) {
-        std::string val = generateExpression(printNode->expression.get());
-        ir.add({"print", val}); 
-    }
-    else if (auto* blockNode = dynamic_cast<BlockNode*>(node)) {
-        for (auto& stmt : blockNode->statements) {
-            generate(stmt.get());
+        case NodeKind::Declaration: {
+            auto* declNode = static_cast<DeclarationNode*>(node);
+            for (auto& varDecl : declNode->declarations) {
+                IROperand varName = IROperand::name(varDecl->name.symbol, varDecl->slot);
+                IROperand initVal = IROperand::constant(0);
+                if (varDecl->initializer) {
+                    initVal = generateExpression(varDecl->initializer.get());
+                } else if (declNode->type == TokenType::NUMBER_ARRAY) {
+                    initVal = newTemp();
+                    ir.add({Opcode::ALLOC_ARR, IROperand::constant(0), {}, initVal});
+                }
+                ir.add({Opcode::VAR, varName});  
+                ir.add({Opcode::ASSIGN, varName, initVal});
+            }
+            break;
         }
-    }
-    else if (auto* ifNode = dynamic_cast<IfStatementNode*>(node)) {
-        std::string endLabel = newLabel();
-        for (size_t i = 0; i < ifNode->conditionBlocks.size(); ++i) {
-            auto& cond = ifNode->conditionBlocks[i].first;
-            auto& block = ifNode->conditionBlocks[i].second;
+        case NodeKind::Assignment: {
+            auto* assignNode = static_cast<AssignmentNode*>(node);
+            if (auto* element = ast_cast<IndexNode>(assignNode->left.get())) {
+                IROperand array = generateExpression(element->array.get());
+                IROperand index = generateExpression(element->index.get());
+                IROperand value = generateExpression(assignNode->rightExpression.get());
+                checkIndex(array, index);
+                ir.add({Opcode::STORE_IDX, array, index, value});
+                break;
+            }
+            auto* target = ast_cast<VariableNode>(assignNode->left.get());
+            IROperand lhs = IROperand::name(target->name, target->slot);
+            IROperand rhs = generateExpression(assignNode->rightExpression.get());
+            ir.add({Opcode::ASSIGN, lhs, rhs}); 
+            break;
+        }
+        case NodeKind::Print: {
+            auto* printNode = static_cast<PrintNode*>(node);
+            IROperand val = generateExpression(printNode->expression.get());
+            ir.add({Opcode::PRINT, val}); 
+            break;
+        }
+        case NodeKind::Block: {
+            auto* blockNode = static_cast<BlockNode*>(node);
+            for (auto& stmt : blockNode->statements) {
+                generate(stmt.get());
+            }
+            break;
+        }
+        case NodeKind::IfStatement: {
+            auto* ifNode = static_cast<IfStatementNode*>(node);
+            IROperand endLabel = newLabel();
+            for (size_t i = 0; i < ifNode->conditionBlocks.size(); ++i) {
+                auto& cond = ifNode->conditionBlocks[i].first;
+                auto& block = ifNode->conditionBlocks[i].second;
 
-            std::string condVal = generateExpression(cond.get());
-            std::string nextLabel = newLabel();
+                IROperand condVal = generateExpression(cond.get());
+                IROperand nextLabel = newLabel();
 
-            ir.add({"ifz_goto", condVal, nextLabel});  
-            generate(block.get());
-            ir.add({"goto", endLabel});  
-            ir.add({"label", nextLabel});  
-        }
+                ir.add({Opcode::IFZ_GOTO, condVal, nextLabel});  
+                generate(block.get());
+                ir.add({Opcode::GOTO, endLabel});  
+                ir.add({Opcode::LABEL, nextLabel});  
+            }
+
+            if (ifNode->elseBranch) {
+                generate(ifNode->elseBranch.get()); 
+            }
 
-        if (ifNode->elseBranch) {
-            generate(ifNode->elseBranch.get()); 
+            ir.add({Opcode::LABEL, endLabel}); 
+            break;
         }
+        case NodeKind::While: {
+            auto* whileNode = static_cast<WhileNode*>(node);
+            IROperand startLabel = newLabel();
+            IROperand endLabel = newLabel();
 
-        ir.add({"label", endLabel}); 
-    }
-    else if (auto* whileNode = dynamic_cast<WhileNode*>(node)) {
-        std::string startLabel = newLabel();
-        std::string endLabel = newLabel();
-
-        ir.add({"label", startLabel});
-        std::string condVal = generateExpression(whileNode->conditionStatement.get());
-        ir.add({"ifz_goto", condVal, endLabel});
-        generate(whileNode->whileBlock.get());
-        ir.add({"goto", startLabel});  
-        ir.add({"label", endLabel});  
-    }
-    else if (auto* funcNode = dynamic_cast<FunctionNode*>(node)) {
-        ir.add({"func_start", funcNode->name});
-        for (auto& param : funcNode->parameters) {
-            ir.add({"param", param.second});  
+            ir.add({Opcode::LABEL, startLabel});
+            IROperand condVal = generateExpression(whileNode->conditionStatement.get());
+            ir.add({Opcode::IFZ_GOTO, condVal, endLabel});
+            generate(whileNode->whileBlock.get());
+            ir.add({Opcode::GOTO, startLabel});  
+            ir.add({Opcode::LABEL, endLabel});  
+            break;
         }
-        generate(funcNode->functionBlock.get());
-        ir.add({"func_end", funcNode->name});
-    }
-    else if (auto* callNode = dynamic_cast<CallExprNode*>(node)) {
-        for (auto& arg : callNode->arguments) {
-            std::string val = generateExpression(arg.get());
-            ir.add({"arg", val});
+        case NodeKind::Function: {
+            auto* funcNode = static_cast<FunctionNode*>(node);
+            IROperand flags = funcNode->memoizable ? IROperand::constant(FUNC_MEMOIZABLE) : IROperand();
+            ir.add({Opcode::FUNC_START, IROperand::name(funcNode->name), IROperand::constant(funcNode->frameSize), flags});
+            for (size_t i = 0; i < funcNode->parameters.size(); ++i) {
+                ir.add({Opcode::PARAM, IROperand::name(funcNode->parameters[i].second, static_cast<long long>(i))});
+            }
+            generate(funcNode->functionBlock.get());
+            ir.add({Opcode::FUNC_END, IROperand::name(funcNode->name)});
+            break;
+        }
+        case NodeKind::CallExpr: {
+            auto* callNode = static_cast<CallExprNode*>(node);
+            if (callNode->builtin != Builtin::NONE) {
+                generateExpression(callNode);
+                break;
+            }
+            for (auto& arg : callNode->arguments) {
+                IROperand val = generateExpression(arg.get());
+                ir.add({Opcode::ARG, val});
+            }
+            ir.add({Opcode::CALL, IROperand::name(callNode->functionName), IROperand::constant(callNode->arguments.size())});
+            break;
         }
-        ir.add({"call", callNode->functionName, std::to_string(callNode->arguments.size())});
+        default:
+            break;
     }
+    // Whatever follows may be reached by a jump past these checks.
+    checkedIndices.clear();
 }
 
-std::string IRGenerator::generateExpression(ASTNode* node) {
-    if (!node) return "";
+IROperand IRGenerator::generateExpression(ASTNode* node) {
+    if (!node) return {};
+    LocationScope location(ir, node);
 
-    if (auto* numNode = dynamic_cast<NumberLiteralNode*>(node)) {
-        return numNode->value;
-    }
-    else if (auto* strNode = dynamic_cast<StringLiteralNode*>(node)) {
-        return "\"" + strNode->value + "\"";
-    }
-    else if (auto* varNode = dynamic_cast<VariableNode*>(node)) {
-        return varNode->name;  
-    }
-    else if (auto* binaryNode = dynamic_cast<BinaryExprNode*>(node)) {
-        std::string left = generateExpression(binaryNode->left.get());
-        std::string right = generateExpression(binaryNode->right.get());
-        std::string temp = newTemp();
-        std::string op;
-
-        switch (binaryNode->op) {
-            case TokenType::PLUS: op = "add"; break;
-            case TokenType::MINUS: op = "sub"; break;
-            case TokenType::MULTIPLY: op = "mul"; break;
-            case TokenType::DIVIDE: 
-                op = "div"; 
-                break;
-            default: op = "unknown"; break;
+    switch (node->kind) {
+        case NodeKind::NumberLiteral: {
+            auto* numNode = static_cast<NumberLiteralNode*>(node);
+            try {
+                return IROperand::constant(std::stoll(numNode->value));
+            } catch (const std::out_of_range&) {
+                std::cerr << "Error: Numeric literal out of range: " << numNode->value << std::endl;
+                return IROperand::constant(0);
+            }
         }
-        ir.add({op, left, right, temp});
-        return temp;
-    }
-    else if (auto* compNode = dynamic_cast<ComparisonNode*>(node)) {
-        std::string left = generateExpression(compNode->leftExpression.get());
-        std::string right = generateExpression(compNode->rightExpression.get());
-        std::string temp = newTemp();
-        std::string op;
-
-        switch (compNode->op) {
-            case TokenType::EQ: op = "eq"; break;
-            case TokenType::NEQ : op = "neq"; break;
-            case TokenType::LT: op = "lt"; break;
-            case TokenType::LEQ : op = "le"; break;
-            case TokenType::GT: op = "gt"; break;
-            case TokenType::GEQ: op = "ge"; break;
-            default: op = "unknown"; break;
-        }
-        ir.add({op, left, right, temp});
-        return temp;
-    }
-    else if (auto* logicalNode = dynamic_cast<LogicalExprNode*>(node)) {
-        std::string left = generateExpression(logicalNode->leftExpression.get());
-        std::string right = generateExpression(logicalNode->rightExpression.get());
-        std::string temp = newTemp();
-        std::string op;
-
-        switch (logicalNode->op) {
-            case TokenType::AND: op = "and"; break;
-            case TokenType::OR: op = "or"; break;
-            default: op = "unknown"; break;
-        }
-        ir.add({op, left, right, temp});
-        return temp;
-    }
-    else if (auto* unaryNode = dynamic_cast<UnaryExprNode*>(node)) {
-        std::string operand = generateExpression(unaryNode->operand.get());
-        std::string temp = newTemp();
-        std::string op;
-
-        switch (unaryNode->op) {
-            case TokenType::MINUS: op = "neg"; break;
-            case TokenType::NOT: op = "not"; break;
-            default: op = "unknown"; break;
-        }
-        ir.add({op, operand, "", temp});
-        return temp;
-    }
-    else if (auto* callNode = dynamic_cast<CallExprNode*>(node)) {
-        for (auto& arg : callNode->arguments) {
-            std::string val = generateExpression(arg.get());
-            ir.add({"arg", val});
-        }
-        ir.add({"call", callNode->functionName, std::to_string(callNode->arguments.size())});
-        std::string temp = newTemp();
-        ir.add({"move", "retval", "", temp});
-        return temp;
+        case NodeKind::StringLiteral: {
+            auto* strNode = static_cast<StringLiteralNode*>(node);
+            return IROperand::string(strNode->value);
+        }
+        case NodeKind::Variable: {
+            auto* varNode = static_cast<VariableNode*>(node);
+            return IROperand::name(varNode->name, varNode->slot);
+        }
+        case NodeKind::BinaryExpr: {
+            auto* binaryNode = static_cast<BinaryExprNode*>(node);
+            IROperand left = generateExpression(binaryNode->left.get());
+            IROperand right = generateExpression(binaryNode->right.get());
+            IROperand temp = newTemp();
+            bool numeric = binaryNode->valueType == Type::NUMBER;
+            Opcode op;
+
+            switch (binaryNode->op) {
+                case TokenType::PLUS:
+                    op = numeric ? Opcode::ADD_I64 : binaryNode->valueType == Type::STRING ? Opcode::CONCAT_STR : Opcode::ADD;
+                    break;
+                case TokenType::MINUS: op = numeric ? Opcode::SUB_I64 : Opcode::SUB; break;
+                case TokenType::MULTIPLY: op = numeric ? Opcode::MUL_I64 : Opcode::MUL; break;
+                case TokenType::DIVIDE: 
+                    op = numeric ? Opcode::DIV_I64 : Opcode::DIV; 
+                    break;
+                default: op = Opcode::UNKNOWN; break;
+            }
+            ir.add({op, left, right, temp});
+            return temp;
+        }
+        case NodeKind::Comparison: {
+            auto* compNode = static_cast<ComparisonNode*>(node);
+            IROperand left = generateExpression(compNode->leftExpression.get());
+            IROperand right = generateExpression(compNode->rightExpression.get());
+            IROperand temp = newTemp();
+            Type leftType = compNode->leftExpression->valueType;
+            Type rightType = compNode->rightExpression->valueType;
+            bool numeric = leftType == Type::NUMBER && rightType == Type::NUMBER;
+            bool strings = leftType == Type::STRING && rightType == Type::STRING;
+            Opcode op;
+
+            switch (compNode->op) {
+                case TokenType::EQ: op = numeric ? Opcode::EQ_I64 : strings ? Opcode::EQ_STR : Opcode::EQ; break;
+                case TokenType::NEQ : op = numeric ? Opcode::NEQ_I64 : strings ? Opcode::NEQ_STR : Opcode::NEQ; break;
+                case TokenType::LT: op = numeric ? Opcode::LT_I64 : Opcode::LT; break;
+                case TokenType::LEQ : op = numeric ? Opcode::LE_I64 : Opcode::LE; break;
+                case TokenType::GT: op = numeric ? Opcode::GT_I64 : Opcode::GT; break;
+                case TokenType::GEQ: op = numeric ? Opcode::GE_I64 : Opcode::GE; break;
+                default: op = Opcode::UNKNOWN; break;
+            }
+            ir.add({op, left, right, temp});
+            return temp;
+        }
+        case NodeKind::LogicalExpr: {
+            auto* logicalNode = static_cast<LogicalExprNode*>(node);
+            IROperand left = generateExpression(logicalNode->leftExpression.get());
+            IROperand right = generateExpression(logicalNode->rightExpression.get());
+            IROperand temp = newTemp();
+            Opcode op;
+
+            switch (logicalNode->op) {
+                case TokenType::AND: op = Opcode::AND; break;
+                case TokenType::OR: op = Opcode::OR; break;
+                default: op = Opcode::UNKNOWN; break;
+            }
+            ir.add({op, left, right, temp});
+            return temp;
+        }
+        case NodeKind::UnaryExpr: {
+            auto* unaryNode = static_cast<UnaryExprNode*>(node);
+            IROperand operand = generateExpression(unaryNode->operand.get());
+            IROperand temp = newTemp();
+            Opcode op;
+
+            switch (unaryNode->op) {
+                case TokenType::MINUS: op = unaryNode->valueType == Type::NUMBER ? Opcode::NEG_I64 : Opcode::NEG; break;
+                case TokenType::NOT: op = Opcode::NOT; break;
+                default: op = Opcode::UNKNOWN; break;
+            }
+            ir.add({op, operand, {}, temp});
+            return temp;
+        }
+        case NodeKind::CallExpr: {
+            auto* callNode = static_cast<CallExprNode*>(node);
+            if (callNode->builtin == Builtin::LEN) {
+                IROperand array = generateExpression(callNode->arguments[0].get());
+                IROperand temp = newTemp();
+                ir.add({Opcode::LEN, array, {}, temp});
+                return temp;
+            }
+            if (callNode->builtin != Builtin::NONE) {
+                // parallelSum and friends: the function is named, not evaluated.
+                auto* function = static_cast<VariableNode*>(callNode->arguments[0].get());
+                for (size_t i = 1; i < callNode->arguments.size(); ++i) {
+                    IROperand val = generateExpression(callNode->arguments[i].get());
+                    ir.add({Opcode::ARG, val});
+                }
+                Opcode op = callNode->builtin == Builtin::PARALLEL_SUM     ? Opcode::PARALLEL_SUM
+                            : callNode->builtin == Builtin::PARALLEL_COUNT ? Opcode::PARALLEL_COUNT
+                                                                           : Opcode::PARALLEL_MAX;
+                IROperand temp = newTemp();
+                ir.add({op, IROperand::name(function->name), {}, temp});
+                return temp;
+            }
+            for (auto& arg : callNode->arguments) {
+                IROperand val = generateExpression(arg.get());
+                ir.add({Opcode::ARG, val});
+            }
+            ir.add({Opcode::CALL, IROperand::name(callNode->functionName), IROperand::constant(callNode->arguments.size())});
+            IROperand temp = newTemp();
+            ir.add({Opcode::MOVE, IROperand::retval(), {}, temp});
+            return temp;
+        }
+        case NodeKind::ArrayAlloc: {
+            auto* allocNode = static_cast<ArrayAllocNode*>(node);
+            IROperand size = generateExpression(allocNode->size.get());
+            IROperand temp = newTemp();
+            ir.add({Opcode::ALLOC_ARR, size, {}, temp});
+            return temp;
+        }
+        case NodeKind::Index: {
+            auto* indexNode = static_cast<IndexNode*>(node);
+            IROperand array = generateExpression(indexNode->array.get());
+            IROperand index = generateExpression(indexNode->index.get());
+            checkIndex(array, index);
+            IROperand temp = newTemp();
+            ir.add({Opcode::LOAD_IDX, array, index, temp});
+            return temp;
+        }
+        default:
+            break;
     }
 
-    return "";
+    return {};
 }
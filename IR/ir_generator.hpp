@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include "ast.hpp"
 #include "ir.hpp"
 
@@ -9,10 +10,16 @@ class IRGenerator {
     int labelCounter = 0;
     int tempVarCounter = 0;
 
-    std::string newLabel();
-    std::string newTemp();
+    // (array, index) pairs already bounds-checked in the current statement.
+    // Nothing in an expression can reassign a variable or resize an array,
+    // so a second access to the same element needs no second check.
+    std::vector<std::pair<IROperand, IROperand>> checkedIndices;
 
-    std::string generateExpression(ASTNode* node);
+    IROperand newLabel();
+    IROperand newTemp();
+    void checkIndex(const IROperand& array, const IROperand& index);
+
+    IROperand generateExpression(ASTNode* node);
 
 public:
     IRGenerator() = default;
@@ -2,98 +2,717 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
 #include <limits>
 #include <cctype>
+#include <condition_variable>
+#include <mutex>
 
-bool isNumericLiteral(const std::string& s) {
-    if (s.empty()) return false;
-    size_t start = 0;
-    if (s[0] == '-') {
-        if (s.length() == 1) return false;
-        start = 1;
+TACInterpreter::TACInterpreter(const IR& intermediate_representation, OutputSink* output)
+    : TACInterpreter(intermediate_representation, std::make_shared<CodeIndex>(intermediate_representation), output) {}
+
+TACInterpreter::TACInterpreter(const IR& intermediate_representation, std::shared_ptr<const CodeIndex> code, OutputSink* output)
+    : ir(intermediate_representation), code(std::move(code)), last_return_value(0LL), output(output), diagnostics(&std::cerr) {
+    if (!this->output) {
+        default_target = std::make_unique<FdOutputTarget>(1);
+        default_output = std::make_unique<OutputSink>(*default_target, OutputSink::policy_for(1));
+        this->output = default_output.get();
+    }
+}
+
+// Approximate cost of one temporaries entry: the node and its bucket.
+constexpr size_t TEMPORARY_BYTES = sizeof(std::pair<const long long, VMValue>) + 2 * sizeof(void*);
+
+// Dispatches between two looks at the clock when a timeout is set.
+constexpr uint64_t CLOCK_CHECK_INTERVAL = 4096;
+
+// Heap bytes behind a value, for the memory limit.
+static size_t value_bytes(const VMValue& value) {
+    if (const StringValue* text = std::get_if<StringValue>(&value)) {
+        return text->size();
     }
-    for (size_t i = start; i < s.length(); ++i) {
-        if (!std::isdigit(s[i])) return false;
+    if (const auto* array = std::get_if<std::shared_ptr<NumberArray>>(&value)) {
+        return (*array)->size() * sizeof(int64_t);
     }
-    return true;
+    return 0;
 }
 
-bool isStringLiteral(const std::string& s) {
-    return s.length() >= 2 && s[0] == '"' && s.back() == '"';
+std::ostream& TACInterpreter::report_error() {
+    failed = true;
+    return *diagnostics;
 }
 
-TACInterpreter::TACInterpreter(const IR& intermediate_representation)
-    : ir(intermediate_representation), last_return_value(0LL) {
-    pre_scan_for_labels_and_functions();
+std::string TACInterpreter::location_suffix(int pc) const {
+    SourceLocation location = ir.locationOf(pc);
+    return location.known() ? " at line " + std::to_string(location.line + 1) : "";
 }
 
-VMValue TACInterpreter::get_operand_value(const std::string& operand_str) {
-    if (isNumericLiteral(operand_str)) {
-        try {
-            return std::stoll(operand_str);
-        } catch (const std::out_of_range& oor) {
-            std::cerr << "Runtime Error: Numeric literal out of range: " << operand_str << std::endl;
-            return 0LL;
+// Variables and temporaries of the current frame, without copying them.
+const VMValue* TACInterpreter::find_operand_value(const IROperand& operand) {
+    if (call_stack.empty()) {
+        return nullptr;
+    }
+    CallFrame& current_frame = call_stack.back();
+    if (operand.kind == IROperand::Kind::NAME) {
+        if (operand.number >= 0 && operand.number < (long long)current_frame.local_variables.size()) {
+            return &current_frame.local_variables[operand.number];
         }
-    } else if (isStringLiteral(operand_str)) {
-        return operand_str.substr(1, operand_str.length() - 2);
-    } else {
-        if (!call_stack.empty()) {
-            CallFrame& current_frame = call_stack.top();
-            if (current_frame.local_variables.count(operand_str)) {
-                return current_frame.local_variables.at(operand_str);
-            }
+    } else if (operand.kind == IROperand::Kind::TEMP) {
+        auto found = current_frame.temporaries.find(operand.number);
+        if (found != current_frame.temporaries.end()) {
+            return &found->second;
         }
-        std::cerr << "Runtime Error: Variable or temporary '" << operand_str << "' not found in current scope." << std::endl;
-        return 0LL;
     }
+    return nullptr;
+}
+
+VMValue TACInterpreter::get_operand_value(const IROperand& operand) {
+    switch (operand.kind) {
+        case IROperand::Kind::NUMBER:
+            return operand.number;
+        case IROperand::Kind::STRING:
+            return code->strings.at(operand.symbol);
+        case IROperand::Kind::RETVAL:
+            return last_return_value;
+        case IROperand::Kind::NAME:
+        case IROperand::Kind::TEMP:
+            if (const VMValue* value = find_operand_value(operand)) {
+                return *value;
+            }
+            break;
+        default:
+            break;
+    }
+    report_error() << "Runtime Error: Variable or temporary '" << operand.toString() << "' not found in current scope." << std::endl;
+    return 0LL;
 }
 
-void TACInterpreter::set_variable_value(const std::string& var_name, VMValue val) {
+void TACInterpreter::set_variable_value(const IROperand& target, VMValue val) {
     if (!call_stack.empty()) {
-        CallFrame& current_frame = call_stack.top();
-        current_frame.local_variables[var_name] = val;
+        CallFrame& current_frame = call_stack.back();
+        VMValue* slot = nullptr;
+        if (target.kind == IROperand::Kind::TEMP) {
+            auto [found, inserted] = current_frame.temporaries.try_emplace(target.number);
+            slot = &found->second;
+            if (inserted && limits.max_memory_bytes) {
+                memory_in_use += TEMPORARY_BYTES;
+            }
+        } else if (target.number >= 0 && target.number < (long long)current_frame.local_variables.size()) {
+            slot = &current_frame.local_variables[target.number];
+        }
+        if (slot) {
+            if (limits.max_memory_bytes) {
+                memory_in_use += value_bytes(val);
+                memory_in_use -= value_bytes(*slot);
+            }
+            *slot = std::move(val);
+        } else {
+            report_error() << "Runtime Error: Variable '" << target.toString() << "' has no slot in the current frame." << std::endl;
+        }
     } else {
-        std::cerr << "Runtime Error: Attempt to set variable '" << var_name << "' with no active call frame. This should not happen (e.g., for global variables in main)." << std::endl;
+        report_error() << "Runtime Error: Attempt to set variable '" << target.toString() << "' with no active call frame. This should not happen (e.g., for global variables in main)." << std::endl;
     }
 }
 
-void TACInterpreter::pre_scan_for_labels_and_functions() {
+void TACInterpreter::print_operand(const IROperand& operand) {
+    const VMValue* val = nullptr;
+    switch (operand.kind) {
+        case IROperand::Kind::NUMBER:
+            output->write_integer(operand.number);
+            break;
+        case IROperand::Kind::STRING:
+            output->write_string(symbolName(operand.symbol));
+            break;
+        case IROperand::Kind::RETVAL:
+            val = &last_return_value;
+            break;
+        default:
+            val = find_operand_value(operand);
+            if (!val) {
+                get_operand_value(operand); // reports the missing variable
+                output->write_integer(0);
+            }
+            break;
+    }
+    if (val) {
+        if (std::holds_alternative<long long>(*val)) {
+            output->write_integer(std::get<long long>(*val));
+        } else if (const StringValue* text = std::get_if<StringValue>(val)) {
+            output->write_string(text->view());
+        } else {
+            const NumberArray& array = *std::get<std::shared_ptr<NumberArray>>(*val);
+            output->write_string("[");
+            for (size_t i = 0; i < array.size(); ++i) {
+                if (i > 0) {
+                    output->write_string(", ");
+                }
+                output->write_integer(array[i]);
+            }
+            output->write_string("]");
+        }
+    }
+    output->write_newline();
+}
+
+NumberArray& TACInterpreter::array_operand(const IROperand& operand) {
+    if (operand.kind == IROperand::Kind::RETVAL) {
+        return *std::get<std::shared_ptr<NumberArray>>(last_return_value);
+    }
+    return *std::get<std::shared_ptr<NumberArray>>(*find_operand_value(operand));
+}
+
+const StringValue& TACInterpreter::string_operand(const IROperand& operand) {
+    if (operand.kind == IROperand::Kind::STRING) {
+        return code->strings.at(operand.symbol);
+    }
+    if (operand.kind == IROperand::Kind::RETVAL) {
+        return std::get<StringValue>(last_return_value);
+    }
+    return std::get<StringValue>(*find_operand_value(operand));
+}
+
+CodeIndex::CodeIndex(const IR& ir) {
     const auto& instructions = ir.instructions;
-    for (int i = 0; i < instructions.size(); ++i) {
+    for (size_t i = 0; i < instructions.size(); ++i) {
         const auto& instr = instructions[i];
-        if (instr.opcode == "label") {
-            labels[instr.arg1] = i;
-        } else if (instr.opcode == "func_start") {
-            function_entry_points[instr.arg1] = i;
+        if (instr.opcode == Opcode::LABEL) {
+            if (instr.arg1.number >= (long long)labels.size()) {
+                labels.resize(instr.arg1.number + 1, -1);
+            }
+            labels[instr.arg1.number] = i;
+        } else if (instr.opcode == Opcode::FUNC_START) {
+            function_entry_points[instr.arg1.symbol] = i;
+        }
+        for (const IROperand* operand : {&instr.arg1, &instr.arg2, &instr.result}) {
+            if (operand->kind == IROperand::Kind::STRING && !strings.count(operand->symbol)) {
+                strings.emplace(operand->symbol, StringValue::constant(symbolName(operand->symbol)));
+            }
+        }
+    }
+}
+
+template <bool Profiled>
+void TACInterpreter::enter_frame(CallFrame& frame, Symbol function) {
+    frame.function = function;
+    if constexpr (Profiled) {
+        auto& stats = profile->functions[function];
+        stats.calls++;
+        if (stats.active++ == 0) {
+            frame.entered = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+template <bool Profiled>
+void TACInterpreter::leave_frame(const CallFrame& frame) {
+    if constexpr (Profiled) {
+        auto& stats = profile->functions[frame.function];
+        if (--stats.active == 0) {
+            stats.inclusive += std::chrono::steady_clock::now() - frame.entered;
+        }
+    }
+}
+
+void TACInterpreter::take_sample(int pc) {
+    sample_buffer.clear();
+    for (size_t i = 0; i < call_stack.size(); ++i) {
+        // Callers are attributed to the call instruction they are waiting on.
+        int at = i + 1 < call_stack.size() ? call_stack[i + 1].return_address - 1 : pc;
+        if (i > 0) {
+            sample_buffer += ';';
+        }
+        sample_buffer += symbolName(call_stack[i].function);
+        SourceLocation location = ir.locationOf(at);
+        if (location.known()) {
+            sample_buffer += ':';
+            sample_buffer += std::to_string(location.line + 1);
+        }
+    }
+    sampler->stacks[sample_buffer]++;
+    sampler->samples++;
+}
+
+size_t TACInterpreter::frame_bytes(const CallFrame& frame) const {
+    size_t bytes = frame.local_variables.size() * sizeof(VMValue) + frame.temporaries.size() * TEMPORARY_BYTES;
+    for (const VMValue& value : frame.local_variables) {
+        bytes += value_bytes(value);
+    }
+    for (const auto& [index, value] : frame.temporaries) {
+        bytes += value_bytes(value);
+    }
+    return bytes;
+}
+
+bool TACInterpreter::checkpoint(Symbol function, int pc, uint64_t executed) {
+    auto where = [&]() {
+        std::string text = " in '" + symbolName(function) + "'";
+        SourceLocation location = ir.locationOf(pc);
+        if (location.known()) {
+            text += " at line " + std::to_string(location.line + 1);
+        }
+        return text;
+    };
+    if (limits.max_instructions && executed > limits.max_instructions) {
+        report_error() << "Runtime Error: Instruction limit of " << limits.max_instructions << " exceeded" << where() << "." << std::endl;
+        return false;
+    }
+    if (limits.max_memory_bytes && memory_in_use > limits.max_memory_bytes) {
+        report_error() << "Runtime Error: Memory limit of " << limits.max_memory_bytes << " bytes exceeded (" << memory_in_use
+                       << " bytes in use)" << where() << "." << std::endl;
+        return false;
+    }
+    if (timed && executed >= next_clock_check) {
+        next_clock_check = executed + CLOCK_CHECK_INTERVAL;
+        auto now = std::chrono::steady_clock::now();
+        if (limits.timeout.count() && now >= deadline) {
+            report_error() << "Runtime Error: Time limit of " << limits.timeout.count() << " ms exceeded after " << executed
+                           << " instructions" << where() << "." << std::endl;
+            return false;
+        }
+        if (now >= slice_deadline) {
+            suspended = true;
+            return false;
         }
     }
+    if (executed >= slice_end) {
+        suspended = true;
+        return false;
+    }
+    return true;
+}
+
+bool TACInterpreter::slice_over(uint64_t executed) const {
+    if (executed >= slice_end) {
+        return true;
+    }
+    return slice_deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= slice_deadline;
 }
 
-void TACInterpreter::execute() {
-    int start_pc = function_entry_points.count("main") ? function_entry_points["main"] : 0;
+// Key of a call to `function` whose `count` arguments are on top of the
+// argument stack. Empty if one of them is not a number.
+MemoCache::Key TACInterpreter::memo_key(Symbol function, long long count) const {
+    MemoCache::Key key;
+    if (count < 0 || (size_t)count > arg_passing_stack.size()) {
+        return key;
+    }
+    key.reserve(count + 1);
+    key.push_back(function);
+    for (size_t i = arg_passing_stack.size() - count; i < arg_passing_stack.size(); ++i) {
+        const long long* number = std::get_if<long long>(&arg_passing_stack[i]);
+        if (!number) {
+            return {};
+        }
+        key.push_back(*number);
+    }
+    return key;
+}
 
-    if (function_entry_points.find("main") == function_entry_points.end()) {
-        std::cerr << "Runtime Error: No 'main' function found to start execution." << std::endl;
+size_t MemoCache::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = key.size();
+    for (long long value : key) {
+        hash = (hash ^ static_cast<uint64_t>(value)) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+    return static_cast<size_t>(hash);
+}
+
+void MemoCache::set_capacity(size_t capacity) {
+    max_entries = capacity;
+    while (index.size() > max_entries) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+        evictions++;
+    }
+}
+
+const VMValue* MemoCache::find(const Key& key) {
+    auto found = index.find(key);
+    if (found == index.end()) {
+        misses++;
+        return nullptr;
+    }
+    hits++;
+    entries.splice(entries.begin(), entries, found->second);
+    return &found->second->second;
+}
+
+void MemoCache::insert(Key key, VMValue value) {
+    if (max_entries == 0) {
         return;
     }
+    auto found = index.find(key);
+    if (found != index.end()) {
+        found->second->second = std::move(value);
+        entries.splice(entries.begin(), entries, found->second);
+        return;
+    }
+    if (index.size() == max_entries) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+        evictions++;
+    }
+    entries.emplace_front(std::move(key), std::move(value));
+    index.emplace(entries.front().first, entries.begin());
+}
+
+void MemoCache::clear() {
+    entries.clear();
+    index.clear();
+}
+
+void SampleProfile::write_folded(std::ostream& out) const {
+    std::vector<std::pair<std::string, uint64_t>> sorted(stacks.begin(), stacks.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (const auto& [stack, count] : sorted) {
+        out << stack << ' ' << count << '\n';
+    }
+}
+
+void TACInterpreter::reset() {
+    call_stack.clear();
+    arg_passing_stack.clear();
+    last_return_value = 0LL;
+    failed = false;
+    memory_in_use = 0;
+    instructions_executed = 0;
+    active_reduction.reset();
+    sample_countdown = sampler ? std::max<uint64_t>(sampler->interval, 1) : 0;
+    time_used = std::chrono::nanoseconds(0);
+}
+
+void TACInterpreter::enter_call(Symbol function, int entry) {
+    CallFrame frame;
+    frame.return_address = -1; 
+    if (profile) {
+        enter_frame<true>(frame, function);
+    } else {
+        enter_frame<false>(frame, function);
+    }
+    call_stack.push_back(std::move(frame));
+    resume_pc = entry;
+    state = ExecutionStatus::SUSPENDED;
+}
+
+void TACInterpreter::start() {
+    reset();
+
+    auto main_entry = code->function_entry_points.find(intern("main"));
+    if (main_entry == code->function_entry_points.end()) {
+        report_error() << "Runtime Error: No 'main' function found to start execution." << std::endl;
+        state = ExecutionStatus::FAILED;
+        return;
+    }
+    enter_call(main_entry->first, main_entry->second);
+}
+
+ExecutionStatus TACInterpreter::resume(const TimeSlice& slice) {
+    if (state != ExecutionStatus::SUSPENDED) {
+        return state;
+    }
+
+    auto began = std::chrono::steady_clock::now();
+    slice_end = slice.instructions ? instructions_executed + slice.instructions : std::numeric_limits<uint64_t>::max();
+    slice_deadline = slice.time.count() ? began + slice.time : std::chrono::steady_clock::time_point::max();
+    deadline = began + (limits.timeout - time_used);
+    timed = limits.timeout.count() || slice.time.count();
+    checked = limits.any() || timed || slice.instructions;
+    next_clock_check = instructions_executed;
+    suspended = false;
+
+    if (profile && sampler) {
+        run<true, true>();
+    } else if (profile) {
+        run<true, false>();
+    } else if (sampler) {
+        run<false, true>();
+    } else {
+        run<false, false>();
+    }
+    time_used += std::chrono::steady_clock::now() - began;
+
+    if (failed) {
+        state = ExecutionStatus::FAILED;
+    } else if (suspended) {
+        return state;
+    } else {
+        state = ExecutionStatus::FINISHED;
+    }
+    output->flush();
+    return state;
+}
+
+bool TACInterpreter::execute() {
+    start();
+    resume();
+    return state == ExecutionStatus::FINISHED;
+}
+
+// Calls below which a chunk of a reduction is not worth handing to another thread.
+constexpr unsigned long long MIN_CHUNK_CALLS = 64;
+
+// Chunks per thread, so that threads which start late or draw slow calls
+// still finish at about the same time.
+constexpr unsigned long long CHUNKS_PER_THREAD = 4;
+
+// What reduction workers print to: the functions they call are pure and never do.
+static OutputSink& silent_sink() {
+    static MemoryOutputTarget nowhere;
+    static OutputSink sink(nowhere, FlushPolicy::ON_EXIT, 1);
+    return sink;
+}
+
+/*
+    One parallelSum, parallelCount or parallelMax. The range is cut into
+    chunks that threads claim in order; each chunk's result is kept apart
+    and the caller combines them in chunk order once every claimed chunk is
+    done, so the result does not depend on which thread ran what. A failed
+    call stops further claims and abandons the chunks after its own, and
+    since chunks are claimed in order, every chunk before it still runs:
+    the error reported is always the one for the smallest failing number.
 
-    CallFrame main_frame;
-    main_frame.return_address = -1; 
-    call_stack.push(main_frame);
+    The calls run on the caller's limits. They count their instructions on
+    from the caller's, all threads together, and stop at the caller's
+    deadline, so the first call to break a limit fails its chunk and the
+    chunks that come later are abandoned while those before it run into
+    the same spent budget at their next call.
 
-    int pc = start_pc; 
+    The caller also checks its time slice between chunks. When the slice
+    ends it stops the claims, waits for the chunks already running and
+    suspends, and resume() carries on with the chunks that are left.
+*/
+struct TACInterpreter::Reduction {
+    Opcode opcode;
+    Symbol function;
+    int entry;
+    long long lo;
+    unsigned long long calls;
+    unsigned long long chunk_calls;
+    size_t chunks;
+
+    // For the workers' interpreters.
+    const IR* ir;
+    std::shared_ptr<const CodeIndex> code;
+    ExecutionLimits limits;
+    size_t memo_entries;
+
+    uint64_t base;                     // the caller's count when the reduction began
+    std::atomic<uint64_t> executed{0}; // by the calls so far
+    std::atomic<size_t> first_failed{std::numeric_limits<size_t>::max()};
+
+    std::vector<long long> partial;  // per chunk
+    std::vector<std::string> errors; // per chunk, empty if every call succeeded
+
+    std::mutex mutex;
+    std::condition_variable chunk_done;
+    std::chrono::steady_clock::time_point deadline; // the caller's, for limits.timeout
+    size_t claimed = 0;
+    size_t finished = 0;
+    bool stopped = false;
+    bool paused = false; // the caller's slice ended
+};
+
+void TACInterpreter::work_through(Reduction& reduction, std::unique_ptr<TACInterpreter>& worker, const TACInterpreter* caller) {
+    std::ostringstream errors;
+    for (;;) {
+        size_t chunk;
+        std::chrono::steady_clock::time_point deadline;
+        {
+            std::lock_guard<std::mutex> lock(reduction.mutex);
+            if (caller && caller->slice_over(reduction.base + reduction.executed)) {
+                reduction.paused = true;
+            }
+            if (reduction.stopped || reduction.paused || reduction.claimed == reduction.chunks) {
+                return;
+            }
+            chunk = reduction.claimed++;
+            deadline = reduction.deadline;
+        }
+
+        if (!worker) {
+            worker = std::make_unique<TACInterpreter>(*reduction.ir, reduction.code, &silent_sink());
+        }
+        worker->set_limits(reduction.limits);
+        worker->set_memoization(reduction.memo_entries);
+        worker->set_diagnostics(errors);
+
+        unsigned long long begin = chunk * reduction.chunk_calls;
+        unsigned long long end = std::min(reduction.calls, begin + reduction.chunk_calls);
+        long long combined = 0;
+        bool ok = true;
+        for (unsigned long long k = begin; k < end && reduction.first_failed >= chunk; ++k) {
+            long long number = reduction.lo + (long long)k;
+            worker->reset();
+            uint64_t start = reduction.base + reduction.executed;
+            worker->instructions_executed = start;
+            if (reduction.limits.timeout.count()) {
+                // Counted as used already, so that resume() stops the call at the caller's deadline.
+                worker->time_used = reduction.limits.timeout - (deadline - std::chrono::steady_clock::now());
+            }
+            worker->arg_passing_stack.push_back(number);
+            worker->enter_call(reduction.function, reduction.entry);
+            bool finished = worker->resume() == ExecutionStatus::FINISHED;
+            uint64_t total = reduction.base + (reduction.executed += worker->instructions_executed - start);
+            // A call too short to reach a checkpoint of its own is checked here.
+            if (!finished || !worker->checkpoint(reduction.function, reduction.entry, total)) {
+                errors << "  in " << symbolName(reduction.function) << "(" << number << ")";
+                ok = false;
+                break;
+            }
+            long long value = std::get<long long>(worker->last_return_value);
+            switch (reduction.opcode) {
+                case Opcode::PARALLEL_COUNT: combined += value != 0; break;
+                case Opcode::PARALLEL_MAX: combined = k == begin ? value : std::max(combined, value); break;
+                default: combined += value; break;
+            }
+        }
+        worker->set_diagnostics(std::cerr);
+
+        std::lock_guard<std::mutex> lock(reduction.mutex);
+        reduction.partial[chunk] = combined;
+        if (!ok) {
+            reduction.errors[chunk] = errors.str();
+            errors.str("");
+            reduction.stopped = true;
+            if (chunk < reduction.first_failed) {
+                reduction.first_failed = chunk;
+            }
+        }
+        reduction.finished++;
+        reduction.chunk_done.notify_all();
+    }
+}
+
+bool TACInterpreter::reduce(const IRInstruction& instr, int pc, uint64_t& executed, long long& result) {
+    result = 0;
+    if (!active_reduction) {
+        long long hi = std::get<long long>(arg_passing_stack.back());
+        arg_passing_stack.pop_back();
+        long long lo = std::get<long long>(arg_passing_stack.back());
+        arg_passing_stack.pop_back();
+
+        if (lo >= hi) {
+            if (instr.opcode == Opcode::PARALLEL_MAX) {
+                report_error() << "Runtime Error: parallelMax over the empty range [" << lo << ", " << hi << ")"
+                               << location_suffix(pc) << "." << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        // Shared with the posted jobs, which may start after this returns.
+        auto reduction = std::make_shared<Reduction>();
+        reduction->opcode = instr.opcode;
+        reduction->function = instr.arg1.symbol;
+        reduction->entry = code->function_entry_points.at(instr.arg1.symbol);
+        reduction->lo = lo;
+        reduction->calls = (unsigned long long)hi - (unsigned long long)lo;
+        reduction->ir = &ir;
+        reduction->code = code;
+        reduction->limits = limits;
+        reduction->memo_entries = memo.capacity();
+        reduction->base = executed;
+
+        unsigned long long threads = parallel ? std::max(1u, parallel->concurrency()) + 1 : 1;
+        unsigned long long chunks = std::min((reduction->calls + MIN_CHUNK_CALLS - 1) / MIN_CHUNK_CALLS, threads * CHUNKS_PER_THREAD);
+        reduction->chunk_calls = (reduction->calls + chunks - 1) / chunks;
+        reduction->chunks = (reduction->calls + reduction->chunk_calls - 1) / reduction->chunk_calls;
+        reduction->partial.resize(reduction->chunks);
+        reduction->errors.resize(reduction->chunks);
+        active_reduction = std::move(reduction);
+    }
+    std::shared_ptr<Reduction> reduction = active_reduction;
+    {
+        // resume() moves the deadline on past the time spent suspended.
+        std::lock_guard<std::mutex> lock(reduction->mutex);
+        reduction->paused = false;
+        reduction->deadline = deadline;
+    }
+
+    if (parallel) {
+        // A job only touches the program once it has claimed a chunk, and
+        // this thread waits for every claimed chunk below before it returns
+        // or suspends, so a job that starts late finds nothing left, or the
+        // claims paused, and returns.
+        unsigned long long threads = std::max(1u, parallel->concurrency()) + 1;
+        size_t helpers = std::min<size_t>(threads - 1, reduction->chunks - reduction->claimed - 1);
+        for (size_t i = 0; i < helpers; ++i) {
+            parallel->post([reduction]() {
+                std::unique_ptr<TACInterpreter> worker;
+                work_through(*reduction, worker);
+            });
+        }
+    }
+    work_through(*reduction, reducer, this);
+    {
+        std::unique_lock<std::mutex> lock(reduction->mutex);
+        reduction->chunk_done.wait(lock, [&] { return reduction->finished == reduction->claimed; });
+    }
+    executed = reduction->base + reduction->executed;
+    if (!reduction->stopped && reduction->claimed < reduction->chunks) {
+        suspended = true;
+        return false;
+    }
+    active_reduction.reset();
+
+    for (size_t chunk = 0; chunk < reduction->chunks; ++chunk) {
+        if (!reduction->errors[chunk].empty()) {
+            const char* builtin = instr.opcode == Opcode::PARALLEL_SUM     ? "parallelSum"
+                                  : instr.opcode == Opcode::PARALLEL_COUNT ? "parallelCount"
+                                                                           : "parallelMax";
+            report_error() << reduction->errors[chunk] << ", called by " << builtin << location_suffix(pc) << "." << std::endl;
+            return false;
+        }
+    }
+    for (size_t chunk = 0; chunk < reduction->chunks; ++chunk) {
+        long long partial = reduction->partial[chunk];
+        if (instr.opcode == Opcode::PARALLEL_MAX) {
+            result = chunk == 0 ? partial : std::max(result, partial);
+        } else {
+            result += partial;
+        }
+    }
+    return true;
+}
+
+template <bool Profiled, bool Sampled>
+void TACInterpreter::run() {
+    // Kept in locals for the dispatch loop and handed back to the members
+    // only when the slice ends, except for the count of a finished run,
+    // which a reduction adds to its caller's.
+    int pc = resume_pc;
+    uint64_t executed = instructions_executed;
+    uint64_t until_sample = sample_countdown;
+    auto save_progress = [&]() {
+        resume_pc = pc;
+        instructions_executed = executed;
+        sample_countdown = until_sample;
+    };
 
     const auto& all_instructions = ir.instructions;
 
     while (pc < all_instructions.size()) {
         const auto& instr = all_instructions[pc];
-        const std::string& opcode = instr.opcode;
+        executed++;
+        if constexpr (Profiled) {
+            profile->opcode_counts[static_cast<size_t>(instr.opcode)]++;
+            profile->instructions++;
+        }
+        if constexpr (Sampled) {
+            if (--until_sample == 0) {
+                until_sample = std::max<uint64_t>(sampler->interval, 1);
+                take_sample(pc);
+            }
+        }
 
-        if (opcode == "func_start") {
-            std::vector<std::string> param_names_in_order;
+        switch (instr.opcode) {
+        case Opcode::FUNC_START: {
+            call_stack.back().local_variables.resize(instr.arg2.number);
+            if (limits.max_memory_bytes) {
+                memory_in_use += instr.arg2.number * sizeof(VMValue);
+            }
+            std::vector<IROperand> param_names_in_order;
             int temp_pc = pc + 1; 
-            while (temp_pc < all_instructions.size() && all_instructions[temp_pc].opcode == "param") {
+            while (temp_pc < all_instructions.size() && all_instructions[temp_pc].opcode == Opcode::PARAM) {
                 param_names_in_order.push_back(all_instructions[temp_pc].arg1);
                 temp_pc++;
             }
@@ -101,155 +720,345 @@ void TACInterpreter::execute() {
             std::vector<VMValue> received_arg_values;
             for (size_t i = 0; i < param_names_in_order.size(); ++i) {
                 if (!arg_passing_stack.empty()) {
-                    received_arg_values.push_back(arg_passing_stack.top());
-                    arg_passing_stack.pop();
+                    received_arg_values.push_back(std::move(arg_passing_stack.back()));
+                    arg_passing_stack.pop_back();
                 } else {
-                    std::cerr << "Runtime Error: Too few arguments for function '" << instr.arg1 << "'." << std::endl;
+                    report_error() << "Runtime Error: Too few arguments for function '" << instr.arg1.toString() << "'." << std::endl;
                     break; 
                 }
             }
 
-            for (int i = 0; i < param_names_in_order.size(); ++i) {
+            for (size_t i = 0; i < param_names_in_order.size(); ++i) {
                 set_variable_value(param_names_in_order[i], 
                                    received_arg_values[param_names_in_order.size() - 1 - i]);
             }
-        } else if (opcode == "func_end") {
+            break;
+        }
+        case Opcode::FUNC_END:
             if (!call_stack.empty()) {
-                CallFrame completed_frame = call_stack.top();
-                call_stack.pop();
+                CallFrame completed_frame = std::move(call_stack.back());
+                call_stack.pop_back();
+                leave_frame<Profiled>(completed_frame);
+                if (limits.max_memory_bytes) {
+                    memory_in_use -= frame_bytes(completed_frame);
+                }
 
                 if (!call_stack.empty()) {
                     pc = completed_frame.return_address;
                     continue;
                 } else {
-                    break;
+                    instructions_executed = executed;
+                    return;
                 }
             } else {
-                std::cerr << "Runtime Error: 'func_end' encountered with empty call stack." << std::endl;
-                break;
+                report_error() << "Runtime Error: 'func_end' encountered with empty call stack." << std::endl;
+                return;
             }
-        } else if (opcode == "var") {
+        case Opcode::VAR:
             set_variable_value(instr.arg1, {0LL});
-        } else if (opcode == "assign") {
+            break;
+        case Opcode::ASSIGN:
             set_variable_value(instr.arg1, get_operand_value(instr.arg2));
-        } else if (opcode == "print") {
-            VMValue val = get_operand_value(instr.arg1);
-            if (std::holds_alternative<long long>(val)) {
-                std::cout << std::get<long long>(val) << std::endl;
-            } else if (std::holds_alternative<std::string>(val)) {
-                std::cout << std::get<std::string>(val) << std::endl;
-            }
-        } else if (opcode == "label") {
-        } else if (opcode == "goto") {
-            pc = labels.at(instr.arg1);
+            break;
+        case Opcode::PRINT:
+            print_operand(instr.arg1);
+            break;
+        case Opcode::LABEL:
+            break;
+        case Opcode::GOTO: {
+            int from = pc;
+            pc = code->labels.at(instr.arg1.number);
+            if (checked && pc <= from && !checkpoint(call_stack.back().function, from, executed)) {
+                save_progress();
+                return;
+            }
             continue;
-        } else if (opcode == "ifz_goto") {
+        }
+        case Opcode::IFZ_GOTO: {
             VMValue cond_val = get_operand_value(instr.arg1);
             if (std::holds_alternative<long long>(cond_val) && std::get<long long>(cond_val) == 0) {
-                pc = labels.at(instr.arg2);
+                int from = pc;
+                pc = code->labels.at(instr.arg2.number);
+                if (checked && pc <= from && !checkpoint(call_stack.back().function, from, executed)) {
+                    save_progress();
+                    return;
+                }
                 continue;
             }
-        } else if (opcode == "ret") {
+            break;
+        }
+        case Opcode::RET:
             last_return_value = get_operand_value(instr.arg1);
             if (!call_stack.empty()) {
-                CallFrame completed_frame = call_stack.top();
-                call_stack.pop();
+                CallFrame completed_frame = std::move(call_stack.back());
+                call_stack.pop_back();
+                leave_frame<Profiled>(completed_frame);
+                if (limits.max_memory_bytes) {
+                    memory_in_use -= frame_bytes(completed_frame);
+                }
+                if (!completed_frame.memo_key.empty()) {
+                    memo.insert(std::move(completed_frame.memo_key), last_return_value);
+                }
 
                 if (!call_stack.empty()) {
                     pc = completed_frame.return_address;
                     continue;
                 } else {
-                    break;
+                    instructions_executed = executed;
+                    return;
                 }
             } else {
-                std::cerr << "Runtime Error: 'ret' instruction with empty call stack." << std::endl;
-                break;
+                report_error() << "Runtime Error: 'ret' instruction with empty call stack." << std::endl;
+                return;
             }
-        } else if (opcode == "arg") {
-            arg_passing_stack.push(get_operand_value(instr.arg1));
-        } else if (opcode == "call") {
-            std::string func_name = instr.arg1;
-
+        case Opcode::ARG:
+            arg_passing_stack.push_back(get_operand_value(instr.arg1));
+            break;
+        case Opcode::CALL: {
+            Symbol caller = call_stack.back().function;
+            if (limits.max_call_depth && call_stack.size() >= limits.max_call_depth) {
+                report_error() << "Runtime Error: Call depth limit of " << limits.max_call_depth << " exceeded calling '"
+                               << symbolName(instr.arg1.symbol) << "' from '" << symbolName(caller) << "'";
+                SourceLocation location = ir.locationOf(pc);
+                if (location.known()) {
+                    *diagnostics << " at line " << location.line + 1;
+                }
+                *diagnostics << "." << std::endl;
+                return;
+            }
+            int entry = code->function_entry_points.at(instr.arg1.symbol);
             CallFrame new_frame;
+            if (memo.capacity() && (all_instructions[entry].result.number & FUNC_MEMOIZABLE)) {
+                MemoCache::Key key = memo_key(instr.arg1.symbol, instr.arg2.number);
+                if (!key.empty()) {
+                    if (const VMValue* cached = memo.find(key)) {
+                        if constexpr (Profiled) {
+                            auto& stats = profile->functions[instr.arg1.symbol];
+                            stats.calls++;
+                            stats.memo_hits++;
+                        }
+                        arg_passing_stack.resize(arg_passing_stack.size() - instr.arg2.number);
+                        last_return_value = *cached;
+                        break;
+                    }
+                    new_frame.memo_key = std::move(key);
+                }
+            }
             new_frame.return_address = pc + 1;
-            call_stack.push(new_frame);
+            enter_frame<Profiled>(new_frame, instr.arg1.symbol);
+            call_stack.push_back(std::move(new_frame));
 
-            pc = function_entry_points.at(func_name);
+            int from = pc;
+            pc = entry;
+            if (checked && !checkpoint(caller, from, executed)) {
+                save_progress();
+                return;
+            }
             continue;
-        } else if (opcode == "param") {
+        }
+        case Opcode::PARAM:
             // Handled by func_start
-        } else if (opcode == "move") {
-            if (instr.arg1 == "retval") {
-                set_variable_value(instr.result, last_return_value);
-            } else {
-                set_variable_value(instr.result, get_operand_value(instr.arg1));
+            break;
+        case Opcode::MOVE:
+            set_variable_value(instr.result, get_operand_value(instr.arg1));
+            break;
+
+        // Operand types proven by the semantic analyzer: no variant checks.
+        case Opcode::ADD_I64:
+            set_variable_value(instr.result, std::get<long long>(get_operand_value(instr.arg1)) + std::get<long long>(get_operand_value(instr.arg2)));
+            break;
+        case Opcode::SUB_I64:
+            set_variable_value(instr.result, std::get<long long>(get_operand_value(instr.arg1)) - std::get<long long>(get_operand_value(instr.arg2)));
+            break;
+        case Opcode::MUL_I64:
+            set_variable_value(instr.result, std::get<long long>(get_operand_value(instr.arg1)) * std::get<long long>(get_operand_value(instr.arg2)));
+            break;
+        case Opcode::DIV_I64: {
+            long long divisor = std::get<long long>(get_operand_value(instr.arg2));
+            if (divisor == 0) {
+                report_error() << "Runtime Error: Division by zero at instruction " << pc << "!" << std::endl;
+                return;
             }
+            set_variable_value(instr.result, std::get<long long>(get_operand_value(instr.arg1)) / divisor);
+            break;
         }
-        else if (opcode == "add" || opcode == "sub" || opcode == "mul" || opcode == "div") {
-            long long val1 = std::get<long long>(get_operand_value(instr.arg1));
-            long long val2 = std::get<long long>(get_operand_value(instr.arg2));
+        case Opcode::NEG_I64:
+            set_variable_value(instr.result, -std::get<long long>(get_operand_value(instr.arg1)));
+            break;
+        case Opcode::EQ_I64:
+        case Opcode::NEQ_I64:
+        case Opcode::LT_I64:
+        case Opcode::LE_I64:
+        case Opcode::GT_I64:
+        case Opcode::GE_I64: {
+            long long num1 = std::get<long long>(get_operand_value(instr.arg1));
+            long long num2 = std::get<long long>(get_operand_value(instr.arg2));
+            bool comparison_result;
+            switch (instr.opcode) {
+                case Opcode::EQ_I64: comparison_result = num1 == num2; break;
+                case Opcode::NEQ_I64: comparison_result = num1 != num2; break;
+                case Opcode::LT_I64: comparison_result = num1 < num2; break;
+                case Opcode::LE_I64: comparison_result = num1 <= num2; break;
+                case Opcode::GT_I64: comparison_result = num1 > num2; break;
+                default: comparison_result = num1 >= num2; break;
+            }
+            set_variable_value(instr.result, (long long)(comparison_result ? 1 : 0));
+            break;
+        }
+        case Opcode::EQ_STR:
+        case Opcode::NEQ_STR: {
+            bool equal = string_operand(instr.arg1) == string_operand(instr.arg2);
+            set_variable_value(instr.result, (long long)(equal == (instr.opcode == Opcode::EQ_STR) ? 1 : 0));
+            break;
+        }
+        case Opcode::CONCAT_STR:
+            set_variable_value(instr.result, string_operand(instr.arg1).concat(string_operand(instr.arg2)));
+            break;
+
+        case Opcode::ALLOC_ARR: {
+            long long size = std::get<long long>(get_operand_value(instr.arg1));
+            if (size < 0) {
+                report_error() << "Runtime Error: Negative array size " << size << location_suffix(pc) << "." << std::endl;
+                return;
+            }
+            if (limits.max_memory_bytes && (unsigned long long)size > limits.max_memory_bytes / sizeof(int64_t)) {
+                report_error() << "Runtime Error: Memory limit of " << limits.max_memory_bytes << " bytes exceeded allocating "
+                               << size << " numbers" << location_suffix(pc) << "." << std::endl;
+                return;
+            }
+            set_variable_value(instr.result, std::make_shared<NumberArray>(size));
+            break;
+        }
+        case Opcode::CHECK_IDX: {
+            long long index = std::get<long long>(get_operand_value(instr.arg2));
+            size_t length = array_operand(instr.arg1).size();
+            if (index < 0 || (unsigned long long)index >= length) {
+                report_error() << "Runtime Error: Index " << index << " out of bounds for array of length " << length
+                               << location_suffix(pc) << "." << std::endl;
+                return;
+            }
+            break;
+        }
+        case Opcode::LOAD_IDX: {
+            const NumberArray& array = array_operand(instr.arg1);
+            set_variable_value(instr.result, (long long)array[std::get<long long>(get_operand_value(instr.arg2))]);
+            break;
+        }
+        case Opcode::STORE_IDX: {
+            NumberArray& array = array_operand(instr.arg1);
+            array[std::get<long long>(get_operand_value(instr.arg2))] = std::get<long long>(get_operand_value(instr.result));
+            break;
+        }
+        case Opcode::LEN:
+            set_variable_value(instr.result, (long long)array_operand(instr.arg1).size());
+            break;
+        case Opcode::PARALLEL_SUM:
+        case Opcode::PARALLEL_COUNT:
+        case Opcode::PARALLEL_MAX: {
+            long long result;
+            if (!reduce(instr, pc, executed, result)) {
+                if (suspended) {
+                    // The instruction runs again on resume and carries on with the reduction.
+                    save_progress();
+                }
+                return;
+            }
+            set_variable_value(instr.result, result);
+            break;
+        }
+
+        // Untyped forms, for IR lowered without type information.
+        case Opcode::ADD:
+        case Opcode::SUB:
+        case Opcode::MUL:
+        case Opcode::DIV: {
+            VMValue val1 = get_operand_value(instr.arg1);
+            VMValue val2 = get_operand_value(instr.arg2);
+            if (instr.opcode == Opcode::ADD && std::holds_alternative<StringValue>(val1) && std::holds_alternative<StringValue>(val2)) {
+                set_variable_value(instr.result, std::get<StringValue>(val1).concat(std::get<StringValue>(val2)));
+                break;
+            }
+            if (!std::holds_alternative<long long>(val1) || !std::holds_alternative<long long>(val2)) {
+                report_error() << "Runtime Error: Type mismatch in '" << opcodeName(instr.opcode) << "': " << instr.arg1.toString() << " vs " << instr.arg2.toString() << " at instruction " << pc << std::endl;
+                return;
+            }
+            long long num1 = std::get<long long>(val1);
+            long long num2 = std::get<long long>(val2);
             long long result_val;
-            if (opcode == "add") result_val = val1 + val2;
-            else if (opcode == "sub") result_val = val1 - val2;
-            else if (opcode == "mul") result_val = val1 * val2;
+            if (instr.opcode == Opcode::ADD) result_val = num1 + num2;
+            else if (instr.opcode == Opcode::SUB) result_val = num1 - num2;
+            else if (instr.opcode == Opcode::MUL) result_val = num1 * num2;
             else {
-                if (val2 == 0) {
-                    std::cerr << "Runtime Error: Division by zero at instruction " << pc << "!" << std::endl;
-                    break;
+                if (num2 == 0) {
+                    report_error() << "Runtime Error: Division by zero at instruction " << pc << "!" << std::endl;
+                    return;
                 }
-                result_val = val1 / val2;
+                result_val = num1 / num2;
             }
             set_variable_value(instr.result, result_val);
+            break;
         }
-        else if (opcode == "eq" || opcode == "neq" || opcode == "lt" || opcode == "le" || opcode == "gt" || opcode == "ge") {
+        case Opcode::EQ:
+        case Opcode::NEQ:
+        case Opcode::LT:
+        case Opcode::LE:
+        case Opcode::GT:
+        case Opcode::GE: {
             VMValue val1 = get_operand_value(instr.arg1);
             VMValue val2 = get_operand_value(instr.arg2);
+            Opcode opcode = instr.opcode;
             bool comparison_result = false;
 
             if (std::holds_alternative<long long>(val1) && std::holds_alternative<long long>(val2)) {
                 long long num1 = std::get<long long>(val1);
                 long long num2 = std::get<long long>(val2);
-                if (opcode == "eq") comparison_result = (num1 == num2);
-                else if (opcode == "neq") comparison_result = (num1 != num2);
-                else if (opcode == "lt") comparison_result = (num1 < num2);
-                else if (opcode == "le") comparison_result = (num1 <= num2);
-                else if (opcode == "gt") comparison_result = (num1 > num2);
-                else if (opcode == "ge") comparison_result = (num1 >= num2);
-            } else if (std::holds_alternative<std::string>(val1) && std::holds_alternative<std::string>(val2)) {
-                std::string str1 = std::get<std::string>(val1);
-                std::string str2 = std::get<std::string>(val2);
-                if (opcode == "eq") comparison_result = (str1 == str2);
-                else if (opcode == "neq") comparison_result = (str1 != str2);
+                if (opcode == Opcode::EQ) comparison_result = (num1 == num2);
+                else if (opcode == Opcode::NEQ) comparison_result = (num1 != num2);
+                else if (opcode == Opcode::LT) comparison_result = (num1 < num2);
+                else if (opcode == Opcode::LE) comparison_result = (num1 <= num2);
+                else if (opcode == Opcode::GT) comparison_result = (num1 > num2);
+                else if (opcode == Opcode::GE) comparison_result = (num1 >= num2);
+            } else if (std::holds_alternative<StringValue>(val1) && std::holds_alternative<StringValue>(val2)) {
+                const StringValue& str1 = std::get<StringValue>(val1);
+                const StringValue& str2 = std::get<StringValue>(val2);
+                if (opcode == Opcode::EQ) comparison_result = (str1 == str2);
+                else if (opcode == Opcode::NEQ) comparison_result = (str1 != str2);
                 else {
-                    std::cerr << "Runtime Error: String comparison for '" << opcode << "' is not supported: " << instr.arg1 << " vs " << instr.arg2 << std::endl;
-                    break;
+                    report_error() << "Runtime Error: String comparison for '" << opcodeName(opcode) << "' is not supported: " << instr.arg1.toString() << " vs " << instr.arg2.toString() << std::endl;
+                    return;
                 }
             } else {
-                std::cerr << "Runtime Error: Type mismatch in comparison '" << opcode << "': " << instr.arg1 << " vs " << instr.arg2 << " at instruction " << pc << std::endl;
-                break;
+                report_error() << "Runtime Error: Type mismatch in comparison '" << opcodeName(opcode) << "': " << instr.arg1.toString() << " vs " << instr.arg2.toString() << " at instruction " << pc << std::endl;
+                return;
             }
             set_variable_value(instr.result, (long long)(comparison_result ? 1 : 0));
+            break;
         }
-        else if (opcode == "and" || opcode == "or") {
+        case Opcode::AND:
+        case Opcode::OR: {
             long long val1 = std::get<long long>(get_operand_value(instr.arg1));
             long long val2 = std::get<long long>(get_operand_value(instr.arg2));
             long long logical_result;
-            if (opcode == "and") logical_result = ((val1 != 0) && (val2 != 0) ? 1 : 0);
+            if (instr.opcode == Opcode::AND) logical_result = ((val1 != 0) && (val2 != 0) ? 1 : 0);
             else logical_result = ((val1 != 0) || (val2 != 0) ? 1 : 0);
             set_variable_value(instr.result, logical_result);
+            break;
         }
-        else if (opcode == "neg") {
+        case Opcode::NEG: {
             long long val = std::get<long long>(get_operand_value(instr.arg1));
             set_variable_value(instr.result, -val);
-        } else if (opcode == "not") {
+            break;
+        }
+        case Opcode::NOT: {
             long long val = std::get<long long>(get_operand_value(instr.arg1));
             set_variable_value(instr.result, (long long)(val == 0 ? 1 : 0));
-        }
-        else {
-            std::cerr << "Runtime Error: Unhandled IR opcode: " << opcode << " at instruction " << pc << std::endl;
             break;
         }
+        default:
+            report_error() << "Runtime Error: Unhandled IR opcode: " << opcodeName(instr.opcode) << " at instruction " << pc << std::endl;
+            return;
+        }
 
         pc++;
     }
-}
\ No newline at end of file
+}
@@ -4,45 +4,319 @@
 #include <vector>
 #include <variant> 
 #include <unordered_map> 
-#include <stack>   
+#include <list>
+#include <ostream>
+#include <memory>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 
 #include "../IR/ir.hpp" 
+#include "output_sink.hpp"
+#include "string_value.hpp"
 
-using VMValue = std::variant<long long, std::string>;
+// A number[]: one contiguous buffer. Arrays are shared by reference, so
+// assigning or passing one never copies its elements.
+using NumberArray = std::vector<int64_t>;
+
+using VMValue = std::variant<long long, StringValue, std::shared_ptr<NumberArray>>;
+
+/*
+    Dynamic counts collected by TACInterpreter::execute() when a profile is
+    attached. Inclusive time covers callees too; recursive calls are only
+    timed at their outermost activation so nothing is counted twice.
+*/
+struct ExecutionProfile {
+    struct FunctionStats {
+        uint64_t calls = 0;
+        uint64_t memo_hits = 0; // calls answered from the memo cache, included in `calls`
+        std::chrono::nanoseconds inclusive{0};
+        int active = 0; // activations currently on the call stack
+    };
+
+    std::array<uint64_t, static_cast<size_t>(Opcode::UNKNOWN) + 1> opcode_counts{};
+    std::unordered_map<Symbol, FunctionStats> functions;
+    uint64_t instructions = 0;
+};
+
+/*
+    Statistical profile: every `interval` instructions the interpreter
+    records the current SIMPL call stack as "main:12;fib:4", each frame a
+    function name and the 1-based line it is executing (for callers, the
+    line of the call). Counting dispatches rather than using a timer signal
+    keeps samples reproducible and the handler out of signal context.
+*/
+struct SampleProfile {
+    uint64_t interval = 997;
+    uint64_t samples = 0;
+    std::unordered_map<std::string, uint64_t> stacks;
+
+    // One "stack count" line per distinct stack, the folded format read by
+    // flamegraph.pl, inferno and speedscope.
+    void write_folded(std::ostream& out) const;
+};
+
+/*
+    Caps on what one execute() may consume; zero leaves a limit off. They
+    are checked where control can loop or recurse (backward jumps and
+    calls), so straight-line code between two checks may overshoot a limit
+    by at most its own length. Memory counts frame slots, temporaries and
+    the contents of the strings and arrays held in them, an array once for
+    every slot that refers to it; values passed between frames in flight
+    are not counted.
+*/
+struct ExecutionLimits {
+    uint64_t max_instructions = 0;
+    size_t max_call_depth = 0;
+    size_t max_memory_bytes = 0;
+    std::chrono::milliseconds timeout{0};
+
+    bool any() const {
+        return max_instructions || max_call_depth || max_memory_bytes || timeout.count();
+    }
+};
+
+// Bounds one TACInterpreter::resume(); zero leaves a bound off. Like the
+// limits, a slice ends at the first backward jump or call past a bound.
+struct TimeSlice {
+    uint64_t instructions = 0;
+    std::chrono::microseconds time{0};
+};
+
+enum class ExecutionStatus {
+    SUSPENDED,  // started and not done; resume() continues it
+    FINISHED,
+    FAILED,     // a runtime error was reported
+};
 
 struct CallFrame {
     int return_address;
-    std::unordered_map<std::string, VMValue> local_variables;
+    Symbol function = 0;
+    std::chrono::steady_clock::time_point entered; // only set when profiling
+    std::vector<VMValue> local_variables; // indexed by frame slot
+    std::unordered_map<long long, VMValue> temporaries;
+    std::vector<long long> memo_key; // when set, `ret` stores the result under it
+};
+
+/*
+    Results of memoizable functions (see FUNC_MEMOIZABLE), keyed on the
+    function and its arguments. Holds at most `capacity` entries and evicts
+    the least recently used one to make room.
+*/
+class MemoCache {
+public:
+    using Key = std::vector<long long>; // function symbol, then the arguments
+
+    void set_capacity(size_t capacity);
+    size_t capacity() const { return max_entries; }
+    size_t size() const { return index.size(); }
+
+    // The cached result for `key`, now the most recently used; null on a miss.
+    const VMValue* find(const Key& key);
+    void insert(Key key, VMValue value);
+    void clear();
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+    using Entry = std::pair<Key, VMValue>;
+
+    size_t max_entries = 0;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
 };
 
 struct VMVariable {
     VMValue value;
 };
 
+// Jump targets and function entry points of an IR. Computed once per
+// program and shared, read-only, by every interpreter that runs it.
+struct CodeIndex {
+    std::vector<int> labels; // label index -> instruction index
+    std::unordered_map<Symbol, int> function_entry_points;
+    // One frozen StringValue per string constant, so equal constants share
+    // a buffer and compare by pointer.
+    std::unordered_map<Symbol, StringValue> strings;
+
+    explicit CodeIndex(const IR& ir);
+};
+
+/*
+    Threads for parallelSum, parallelCount and parallelMax. post() runs
+    `job` once, on some other thread, now or later. The interpreter works
+    through the range itself as well and never waits for a posted job to
+    start, so a runner whose threads are all busy costs parallelism but
+    cannot deadlock, even when the interpreter runs on one of them.
+*/
+class ParallelRunner {
+public:
+    virtual ~ParallelRunner() = default;
+    virtual unsigned concurrency() const = 0;
+    virtual void post(std::function<void()> job) = 0;
+};
+
 class TACInterpreter {
 private:
+    struct Reduction;
+
     const IR& ir;
+    std::shared_ptr<const CodeIndex> code;
 
     VMValue last_return_value; 
 
-    std::unordered_map<std::string, int> labels;
-    std::unordered_map<std::string, int> function_entry_points;
+    std::vector<VMValue> arg_passing_stack; // a stack; a memoized call reads its top entries as the key
+
+    std::vector<CallFrame> call_stack; // innermost frame last
+
+    std::unique_ptr<FdOutputTarget> default_target;
+    std::unique_ptr<OutputSink> default_output;
+    OutputSink* output;
+    ExecutionProfile* profile = nullptr;
+    SampleProfile* sampler = nullptr;
+    std::string sample_buffer;
+    std::ostream* diagnostics;
+    bool failed = false;
 
-    std::stack<VMValue> arg_passing_stack;
+    MemoCache memo;
 
-    std::stack<CallFrame> call_stack;
+    ParallelRunner* parallel = nullptr;
+    std::unique_ptr<TACInterpreter> reducer; // runs this thread's share of a reduction
+    std::shared_ptr<Reduction> active_reduction; // one the slice ended in the middle of
 
-    VMValue get_operand_value(const std::string& operand_str);
+    ExecutionLimits limits;
+    uint64_t next_clock_check = 0;
+    std::chrono::steady_clock::time_point deadline;
+    size_t memory_in_use = 0;       // only tracked with a memory limit
 
-    void set_variable_value(const std::string& var_name, VMValue val);
+    // Where a suspended run picks up again; the rest of its state is the
+    // call stack, the argument stack and the last return value.
+    ExecutionStatus state = ExecutionStatus::FINISHED;
+    int resume_pc = 0;
+    uint64_t instructions_executed = 0;
+    uint64_t sample_countdown = 0;
+    std::chrono::nanoseconds time_used{0}; // inside resume(), for limits.timeout
 
-    void pre_scan_for_labels_and_functions();
+    // Set up by resume() for the slice it runs.
+    bool checked = false;           // any limit or slice bound to check
+    bool timed = false;             // the clock has to be read
+    bool suspended = false;
+    uint64_t slice_end = 0;
+    std::chrono::steady_clock::time_point slice_deadline;
+
+    const VMValue* find_operand_value(const IROperand& operand);
+
+    VMValue get_operand_value(const IROperand& operand);
+
+    void print_operand(const IROperand& operand);
+
+    // The array an operand refers to; the analyzer has proven its type.
+    NumberArray& array_operand(const IROperand& operand);
+
+    // Likewise for strings, without copying the value.
+    const StringValue& string_operand(const IROperand& operand);
+
+    void set_variable_value(const IROperand& target, VMValue val);
+
+    // Stream for a runtime error message; marks the current run as failed.
+    std::ostream& report_error();
+
+    // " at line N" for the instruction at `pc`, or nothing if unknown.
+    std::string location_suffix(int pc) const;
+
+    template <bool Profiled, bool Sampled>
+    void run();
+
+    void take_sample(int pc);
+
+    // Called at backward jumps and calls. False once the run has to stop:
+    // after reporting a broken limit, or with `suspended` set at the end of
+    // the slice. `function` and `pc` say where, for the error message.
+    bool checkpoint(Symbol function, int pc, uint64_t executed);
+
+    // Whether the slice resume() set up is over after `executed` instructions.
+    bool slice_over(uint64_t executed) const;
+
+    size_t frame_bytes(const CallFrame& frame) const;
+
+    MemoCache::Key memo_key(Symbol function, long long count) const;
+
+    template <bool Profiled>
+    void enter_frame(CallFrame& frame, Symbol function);
+
+    template <bool Profiled>
+    void leave_frame(const CallFrame& frame);
+
+    // Clears the state of the previous run.
+    void reset();
+
+    // Pushes the outermost frame of a run of `function`, which starts at
+    // `entry` and takes its arguments from the argument stack.
+    void enter_call(Symbol function, int entry);
+
+    // parallelSum, parallelCount or parallelMax over the range on the
+    // argument stack, or the rest of active_reduction. Adds the calls'
+    // instructions to `executed`. False after reporting a runtime error, or
+    // with `suspended` set when the slice ended between two chunks.
+    bool reduce(const IRInstruction& instr, int pc, uint64_t& executed, long long& result);
+
+    // Claims chunks of `reduction` until none are left and runs them on
+    // `worker`, which is created on the first claim. With a `caller`, stops
+    // claiming once the caller's slice is over.
+    static void work_through(Reduction& reduction, std::unique_ptr<TACInterpreter>& worker, const TACInterpreter* caller = nullptr);
 
 public:
-    TACInterpreter(const IR& intermediate_representation);
+    // `print` goes to `output` when given, otherwise to a sink over
+    // standard output that is line buffered only when stdout is a terminal.
+    TACInterpreter(const IR& intermediate_representation, OutputSink* output = nullptr);
 
-    void execute();
-};
+    // Runs `intermediate_representation` using an index built beforehand,
+    // so many interpreters can share one compiled program.
+    TACInterpreter(const IR& intermediate_representation, std::shared_ptr<const CodeIndex> code, OutputSink* output);
+
+    // Runtime errors are written to std::cerr unless redirected here.
+    void set_diagnostics(std::ostream& stream) { diagnostics = &stream; }
+
+    // Counts every instruction and call of the next execute() into `profile`.
+    void set_profile(ExecutionProfile* profile) { this->profile = profile; }
+
+    // Samples the call stack of the next execute() into `sampler`.
+    void set_sampler(SampleProfile* sampler) { this->sampler = sampler; }
 
-bool isNumericLiteral(const std::string& s);
-bool isStringLiteral(const std::string& s);
\ No newline at end of file
+    // Answers calls to memoizable functions from a cache of up to `entries`
+    // results; 0, the default, turns memoization off. Results stay cached
+    // across runs, since they depend on the program and arguments alone.
+    void set_memoization(size_t entries) { memo.set_capacity(entries); }
+    const MemoCache& memo_cache() const { return memo; }
+
+    // Applies to every later execute(); a breach stops the run with a runtime error.
+    // The calls a parallelSum and the like makes count towards the
+    // instruction limit and the timeout of the run, and each has the
+    // memory and call depth limits to itself.
+    void set_limits(const ExecutionLimits& limits) { this->limits = limits; }
+
+    // Spreads parallelSum, parallelCount and parallelMax over `runner`,
+    // which must outlive the interpreter; without one they run on the
+    // calling thread.
+    void set_parallel_runner(ParallelRunner* runner) { parallel = runner; }
+
+    // Sets up a fresh run of main() without executing any of it.
+    void start();
+
+    // Continues the started run for at most `slice` and reports where it
+    // stands. Output is flushed once the run finishes or fails, so many
+    // interpreters can take turns on one thread.
+    ExecutionStatus resume(const TimeSlice& slice = {});
+
+    ExecutionStatus status() const { return state; }
+
+    // start() and resume() to the end. Returns false if a runtime error was
+    // reported. May be called again.
+    bool execute();
+};
@@ -0,0 +1,181 @@
+#include "output_sink.hpp"
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+bool FdOutputTarget::write(const char* data, size_t size) {
+    while (size > 0) {
+#ifndef _WIN32
+        ssize_t count = ::write(fd, data, size);
+#else
+        int count = ::_write(fd, data, static_cast<unsigned>(size));
+#endif
+        if (count <= 0) {
+            return false;
+        }
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+bool MemoryOutputTarget::write(const char* data, size_t size) {
+    captured.append(data, size);
+    return true;
+}
+
+#ifndef _WIN32
+
+MappedFileOutputTarget::MappedFileOutputTarget(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+}
+
+MappedFileOutputTarget::~MappedFileOutputTarget() {
+    close();
+}
+
+bool MappedFileOutputTarget::reserve(size_t needed) {
+    if (needed <= mapped_size) {
+        return true;
+    }
+    size_t new_size = mapped_size ? mapped_size : 1 << 20;
+    while (new_size < needed) {
+        new_size *= 2;
+    }
+    if (mapping) {
+        ::munmap(mapping, mapped_size);
+        mapping = nullptr;
+        mapped_size = 0;
+    }
+    if (::ftruncate(fd, static_cast<off_t>(new_size)) != 0) {
+        return false;
+    }
+    void* region = ::mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (region == MAP_FAILED) {
+        return false;
+    }
+    mapping = static_cast<char*>(region);
+    mapped_size = new_size;
+    return true;
+}
+
+bool MappedFileOutputTarget::write(const char* data, size_t size) {
+    if (fd < 0 || !reserve(written + size)) {
+        return false;
+    }
+    std::memcpy(mapping + written, data, size);
+    written += size;
+    return true;
+}
+
+void MappedFileOutputTarget::close() {
+    if (fd < 0) {
+        return;
+    }
+    if (mapping) {
+        ::munmap(mapping, mapped_size);
+        mapping = nullptr;
+    }
+    ::ftruncate(fd, static_cast<off_t>(written));
+    ::close(fd);
+    fd = -1;
+}
+
+#else
+
+// No mapping on Windows: plain descriptor writes instead.
+MappedFileOutputTarget::MappedFileOutputTarget(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file) {
+        std::fclose(file);
+        fd = ::_open(path.c_str(), _O_WRONLY | _O_BINARY);
+    }
+}
+
+MappedFileOutputTarget::~MappedFileOutputTarget() {
+    close();
+}
+
+bool MappedFileOutputTarget::reserve(size_t) {
+    return true;
+}
+
+bool MappedFileOutputTarget::write(const char* data, size_t size) {
+    return fd >= 0 && FdOutputTarget(fd).write(data, size);
+}
+
+void MappedFileOutputTarget::close() {
+    if (fd >= 0) {
+        ::_close(fd);
+        fd = -1;
+    }
+}
+
+#endif
+
+OutputSink::OutputSink(OutputTarget& target, FlushPolicy policy, size_t capacity)
+    : target(target), policy(policy), capacity(capacity ? capacity : 1) {
+    buffer.reserve(this->capacity);
+}
+
+OutputSink::~OutputSink() {
+    flush();
+}
+
+FlushPolicy OutputSink::policy_for(int fd) {
+#ifndef _WIN32
+    return ::isatty(fd) ? FlushPolicy::LINE : FlushPolicy::THRESHOLD;
+#else
+    return ::_isatty(fd) ? FlushPolicy::LINE : FlushPolicy::THRESHOLD;
+#endif
+}
+
+void OutputSink::make_room(size_t size) {
+    if (policy != FlushPolicy::ON_EXIT && buffer.size() + size > capacity) {
+        flush();
+    }
+}
+
+void OutputSink::write_integer(long long value) {
+    char digits[24];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+    (void)error; // 24 characters always fit a long long
+    make_room(end - digits);
+    buffer.insert(buffer.end(), digits, end);
+}
+
+void OutputSink::write_string(std::string_view text) {
+    make_room(text.size());
+    if (policy != FlushPolicy::ON_EXIT && text.size() >= capacity) {
+        // Larger than the whole buffer: skip the copy.
+        target.write(text.data(), text.size());
+        return;
+    }
+    buffer.insert(buffer.end(), text.begin(), text.end());
+}
+
+void OutputSink::write_newline() {
+    make_room(1);
+    buffer.push_back('\n');
+    if (policy == FlushPolicy::LINE) {
+        flush();
+    }
+}
+
+bool OutputSink::flush() {
+    if (buffer.empty()) {
+        return true;
+    }
+    bool ok = target.write(buffer.data(), buffer.size());
+    buffer.clear();
+    return ok;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+    Where the bytes written by `print` end up. A target only sees whole
+    buffers, never single values.
+*/
+class OutputTarget {
+public:
+    virtual ~OutputTarget() = default;
+    // Returns false if the bytes could not be written.
+    virtual bool write(const char* data, size_t size) = 0;
+};
+
+// An already open file descriptor, such as standard output.
+class FdOutputTarget : public OutputTarget {
+public:
+    explicit FdOutputTarget(int fd) : fd(fd) {}
+    bool write(const char* data, size_t size) override;
+    int descriptor() const { return fd; }
+
+private:
+    int fd;
+};
+
+// Keeps everything in memory; for tests and for embedding the interpreter.
+class MemoryOutputTarget : public OutputTarget {
+public:
+    bool write(const char* data, size_t size) override;
+    const std::string& contents() const { return captured; }
+    void clear() { captured.clear(); }
+
+private:
+    std::string captured;
+};
+
+/*
+    Writes into a file through a shared memory mapping that grows by
+    doubling. The file is cut back to the bytes actually written when the
+    target is closed or destroyed.
+*/
+class MappedFileOutputTarget : public OutputTarget {
+public:
+    explicit MappedFileOutputTarget(const std::string& path);
+    ~MappedFileOutputTarget() override;
+    MappedFileOutputTarget(const MappedFileOutputTarget&) = delete;
+    MappedFileOutputTarget& operator=(const MappedFileOutputTarget&) = delete;
+
+    bool is_open() const { return fd >= 0; }
+    bool write(const char* data, size_t size) override;
+    void close();
+
+private:
+    bool reserve(size_t needed);
+
+    int fd = -1;
+    char* mapping = nullptr;
+    size_t mapped_size = 0;
+    size_t written = 0;
+};
+
+enum class FlushPolicy {
+    ON_EXIT,    // only when flush() is called or the sink is destroyed
+    THRESHOLD,  // whenever the buffer reaches its capacity
+    LINE        // after every newline, as a terminal expects
+};
+
+/*
+    User-space buffer between the interpreter and an OutputTarget. Values
+    are formatted straight into the buffer: integers with std::to_chars and
+    strings by copying their bytes, so printing allocates nothing once the
+    buffer has reached its working size.
+*/
+class OutputSink {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+
+    OutputSink(OutputTarget& target, FlushPolicy policy, size_t capacity = DEFAULT_CAPACITY);
+    ~OutputSink();
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    // LINE when `fd` is a terminal, THRESHOLD otherwise.
+    static FlushPolicy policy_for(int fd);
+
+    void write_integer(long long value);
+    void write_string(std::string_view text);
+    void write_newline();
+
+    // Hands everything buffered so far to the target.
+    bool flush();
+
+private:
+    void make_room(size_t size);
+
+    OutputTarget& target;
+    FlushPolicy policy;
+    size_t capacity;
+    std::vector<char> buffer;
+};
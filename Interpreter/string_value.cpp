@@ -0,0 +1,69 @@
+#include "string_value.hpp"
+#include <cstring>
+
+static uint64_t fnv1a(std::string_view text) {
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char byte : text) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+StringValue::StringValue(std::string_view text) : length(text.size()) {
+    if (!text.empty()) {
+        buffer = std::make_shared<Buffer>();
+        buffer->bytes.assign(text);
+    }
+}
+
+StringValue StringValue::constant(std::string_view text) {
+    StringValue value(text);
+    if (value.buffer) {
+        value.buffer->frozen = true;
+        value.buffer->hashed_length = value.length;
+        value.buffer->hashed = fnv1a(text);
+    }
+    return value;
+}
+
+std::string_view StringValue::view() const {
+    return buffer ? std::string_view(buffer->bytes.data(), length) : std::string_view();
+}
+
+const uint64_t* StringValue::cached_hash() const {
+    return buffer && buffer->hashed_length == length ? &buffer->hashed : nullptr;
+}
+
+StringValue StringValue::concat(const StringValue& other) const {
+    if (other.length == 0) {
+        return *this;
+    }
+    if (length == 0) {
+        return other;
+    }
+    if (!buffer->frozen && buffer->bytes.size() == length && other.buffer != buffer) {
+        buffer->bytes.append(other.view());
+        return StringValue(buffer, length + other.length);
+    }
+    auto joined = std::make_shared<Buffer>();
+    joined->bytes.reserve(length + other.length);
+    joined->bytes.append(view());
+    joined->bytes.append(other.view());
+    return StringValue(std::move(joined), length + other.length);
+}
+
+bool operator==(const StringValue& a, const StringValue& b) {
+    if (a.length != b.length) {
+        return false;
+    }
+    if (a.length == 0 || a.buffer == b.buffer) {
+        return true;
+    }
+    const uint64_t* hash_a = a.cached_hash();
+    const uint64_t* hash_b = b.cached_hash();
+    if (hash_a && hash_b && *hash_a != *hash_b) {
+        return false;
+    }
+    return std::memcmp(a.buffer->bytes.data(), b.buffer->bytes.data(), a.length) == 0;
+}
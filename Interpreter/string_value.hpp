@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/*
+    A string as the interpreter holds it: the first `length` bytes of a
+    shared, reference-counted buffer. Strings are immutable, so copying one
+    copies a pointer and never the bytes.
+
+    concat() appends to the left operand's buffer in place when that operand
+    ends where the buffer does. No other string can tell, since none looks
+    past its own length, so `report = report + line;` in a loop fills one
+    growing buffer like a string builder and costs time linear in the final
+    length rather than quadratic. Frozen buffers, which several threads may
+    read, are never appended to; concatenating onto one copies it first.
+*/
+class StringValue {
+public:
+    StringValue() = default; // the empty string
+    explicit StringValue(std::string_view text);
+
+    // A frozen string with its hash computed up front, for string constants.
+    static StringValue constant(std::string_view text);
+
+    size_t size() const { return length; }
+    std::string_view view() const;
+
+    StringValue concat(const StringValue& other) const;
+
+    // Equal lengths first, then the same buffer, then the hashes of
+    // constants, which are computed up front, and only then the bytes.
+    friend bool operator==(const StringValue& a, const StringValue& b);
+    friend bool operator!=(const StringValue& a, const StringValue& b) { return !(a == b); }
+
+private:
+    struct Buffer {
+        std::string bytes;
+        bool frozen = false;
+        // FNV-1a of the first `hashed_length` bytes; set for constants only.
+        size_t hashed_length = std::string::npos;
+        uint64_t hashed = 0;
+    };
+
+    StringValue(std::shared_ptr<Buffer> buffer, size_t length) : buffer(std::move(buffer)), length(length) {}
+
+    // The hash if it is already known.
+    const uint64_t* cached_hash() const;
+
+    std::shared_ptr<Buffer> buffer; // null for the empty string
+    size_t length = 0;
+};
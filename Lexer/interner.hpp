@@ -0,0 +1,101 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+/*
+    Every distinct identifier (and string literal) is stored once and handed
+    out as a 32-bit Symbol. Later phases compare and hash the id instead of
+    the text; the text is only looked up again for printing and diagnostics.
+    Any thread may intern; only intern() takes a lock, so the many lookups
+    from parallel compiler workers do not contend.
+*/
+using Symbol = uint32_t;
+
+class StringInterner {
+public:
+    StringInterner() {
+        intern(""); // Symbol 0 is always the empty string
+    }
+
+    ~StringInterner() {
+        for (auto& chunk : chunks) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    Symbol intern(std::string_view text) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = ids.find(text);
+        if (found != ids.end()) {
+            return found->second;
+        }
+        Symbol id = static_cast<Symbol>(count.load(std::memory_order_relaxed));
+        auto [chunk, offset] = locate(id);
+        std::string* slots = chunks[chunk].load(std::memory_order_relaxed);
+        if (!slots) {
+            slots = new std::string[size_t(FIRST_CHUNK) << chunk];
+            chunks[chunk].store(slots, std::memory_order_release);
+        }
+        slots[offset].assign(text);
+        ids.emplace(slots[offset], id); // keys view into storage that never moves
+        count.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    // Takes no lock: a string never moves or changes once interned, and
+    // whoever holds its Symbol got it after the string was written.
+    const std::string& str(Symbol id) const {
+        auto [chunk, offset] = locate(id);
+        return chunks[chunk].load(std::memory_order_acquire)[offset];
+    }
+
+    size_t size() const {
+        return count.load(std::memory_order_acquire);
+    }
+
+private:
+    // Chunk k holds FIRST_CHUNK << k strings, so 32 chunks cover every Symbol.
+    static constexpr uint64_t FIRST_CHUNK = 64;
+    static constexpr int FIRST_CHUNK_BITS = 6;
+
+    static std::pair<unsigned, size_t> locate(Symbol id) {
+        uint64_t position = uint64_t(id) + FIRST_CHUNK;
+#if defined(__GNUC__)
+        unsigned top = 63 - __builtin_clzll(position);
+#else
+        unsigned top = 0;
+        while (position >> (top + 1)) {
+            top++;
+        }
+#endif
+        unsigned chunk = top - FIRST_CHUNK_BITS;
+        return {chunk, size_t(position - (uint64_t(1) << top))};
+    }
+
+    std::mutex mutex; // taken by intern() only
+    std::array<std::atomic<std::string*>, 32> chunks{};
+    std::atomic<size_t> count{0};
+    std::unordered_map<std::string_view, Symbol> ids;
+};
+
+inline StringInterner& globalInterner() {
+    static StringInterner interner;
+    return interner;
+}
+
+inline Symbol intern(std::string_view text) {
+    return globalInterner().intern(text);
+}
+
+inline const std::string& symbolName(Symbol id) {
+    return globalInterner().str(id);
+}
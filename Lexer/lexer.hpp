@@ -89,6 +89,13 @@ private:
             advance();
         }
         if (val == "number") {
+            // "number[]" is the array type; "number[" followed by anything
+            // else starts an allocation such as number[n].
+            if (source.compare(pos, 2, "[]") == 0) {
+                advance();
+                advance();
+                return Token(TokenType::NUMBER_ARRAY, "number[]", startLine, startCol);
+            }
             return Token(TokenType::NUMBER, val, startLine, startCol);
         } else if (val == "string") {
             return Token(TokenType::STRING, val, startLine, startCol);
@@ -108,7 +115,8 @@ private:
             return Token(TokenType::PRINT, val, startLine, startCol);
         }
         // Otherwise it's an identifier
-        return Token(TokenType::IDENTIFIER, val, startLine, startCol);
+        Symbol symbol = intern(val);
+        return Token(TokenType::IDENTIFIER, std::move(val), startLine, startCol, symbol);
     }
 
     Token tokenizeString(int startLine, int startCol) {
@@ -120,7 +128,8 @@ private:
         }
         if (peek() == '"') {
             advance(); 
-            return Token(TokenType::STRING_LITERAL, val, startLine, startCol);
+            Symbol symbol = intern(val);
+            return Token(TokenType::STRING_LITERAL, std::move(val), startLine, startCol, symbol);
         }
         return Token(TokenType::UNKNOWN, val, startLine, startCol);
     }
@@ -165,6 +174,8 @@ private:
             case ')': advance(); return Token(TokenType::RPAREN, single, startLine, startCol);
             case '{': advance(); return Token(TokenType::LBRACE, single, startLine, startCol);
             case '}': advance(); return Token(TokenType::RBRACE, single, startLine, startCol);
+            case '[': advance(); return Token(TokenType::LBRACKET, single, startLine, startCol);
+            case ']': advance(); return Token(TokenType::RBRACKET, single, startLine, startCol);
             case '+': advance(); return Token(TokenType::PLUS, single, startLine, startCol);
             case '-': advance(); return Token(TokenType::MINUS, single, startLine, startCol);
             case '*': advance(); return Token(TokenType::MULTIPLY, single, startLine, startCol);
@@ -1,5 +1,6 @@
 #pragma once
 #include<iostream>
+#include "interner.hpp"
 
 enum class TokenType {
     IF, ELIF, ELSE,
@@ -8,7 +9,8 @@ enum class TokenType {
     NUMBER_LITERAL, STRING_LITERAL,
     ASSIGN, PLUS, MINUS, DIVIDE, MULTIPLY, LPAREN, RPAREN, LBRACE, RBRACE, COMMA, SEMICOLON, 
     END_OF_FILE, UNKNOWN,
-    EQ, NEQ, LT, GT, LEQ, GEQ, AND, OR, NOT
+    EQ, NEQ, LT, GT, LEQ, GEQ, AND, OR, NOT,
+    NUMBER_ARRAY, LBRACKET, RBRACKET
 };
 
 inline std::ostream& operator<<(std::ostream& os, TokenType type) {
@@ -23,6 +25,7 @@ inline std::ostream& operator<<(std::ostream& os, TokenType type) {
         case TokenType::IDENTIFIER: return os << "IDENTIFIER";
         case TokenType::NUMBER: return os << "NUMBER";
         case TokenType::STRING: return os << "STRING";
+        case TokenType::NUMBER_ARRAY: return os << "NUMBER_ARRAY";
         case TokenType::NUMBER_LITERAL: return os << "NUMBER_LITERAL";
         case TokenType::STRING_LITERAL: return os << "STRING_LITERAL";
         case TokenType::ASSIGN: return os << "ASSIGN";
@@ -34,6 +37,8 @@ inline std::ostream& operator<<(std::ostream& os, TokenType type) {
         case TokenType::RPAREN: return os << "RPAREN";
         case TokenType::LBRACE: return os << "LBRACE";
         case TokenType::RBRACE: return os << "RBRACE";
+        case TokenType::LBRACKET: return os << "LBRACKET";
+        case TokenType::RBRACKET: return os << "RBRACKET";
         case TokenType::COMMA: return os << "COMMA";
         case TokenType::SEMICOLON: return os << "SEMICOLON";
         case TokenType::END_OF_FILE: return os << "END_OF_FILE";
@@ -56,13 +61,15 @@ struct Token {
     TokenType type;
     std::string value;
     int line, column;
+    Symbol symbol = 0; // interned text for IDENTIFIER and STRING_LITERAL tokens
 
     Token() = default;
 
-    Token(TokenType type, std::string value, int line, int column) {
+    Token(TokenType type, std::string value, int line, int column, Symbol symbol = 0) {
         this -> type = type;
         this -> value = value;
         this -> line = line;
         this -> column = column;
+        this -> symbol = symbol;
     }
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include<vector>
 #include<string>
 #include<../Lexer/token.hpp>
+#include "ast_arena.hpp"
 
 class ASTNode;
 class ReturnNode;
@@ -23,80 +24,166 @@ class FunctionNode;
 class CallExprNode;
 class WhileNode;
 class BlockNode;
+class ArrayAllocNode;
+class IndexNode;
+
+
+/*
+    Every node carries its concrete kind, so the phases dispatch with a single
+    switch instead of probing the tree with dynamic_cast.
+*/
+enum class NodeKind {
+    Return,
+    Variable,
+    Declaration,
+    VarDeclare,
+    NumberLiteral,
+    StringLiteral,
+    IfStatement,
+    Comparison,
+    LogicalExpr,
+    BinaryExpr,
+    UnaryExpr,
+    Assignment,
+    Print,
+    Function,
+    CallExpr,
+    While,
+    Block,
+    ArrayAlloc,
+    Index
+};
+
+/*
+    Static type of a value. Declared here rather than next to the symbol
+    table because the semantic analyzer records resolved types on the tree.
+*/
+enum class Type {
+    NUMBER,
+    STRING,
+    VOID,
+    UNKNOWN,
+    NUMBER_ARRAY
+};
 
+/*
+    Functions the language provides itself. A call to one is resolved by the
+    semantic analyzer and lowered to dedicated IR instead of a `call`.
+*/
+enum class Builtin {
+    NONE,
+    LEN,            // len(number[]) -> number
+    PARALLEL_SUM,   // parallelSum(f, lo, hi): f(lo) + ... + f(hi - 1)
+    PARALLEL_COUNT, // parallelCount(pred, lo, hi): how many i in [lo, hi) have pred(i) != 0
+    PARALLEL_MAX    // parallelMax(f, lo, hi): the largest f(i) for i in [lo, hi)
+};
 
 class ASTNode {
     public:
-        virtual ~ASTNode() = default;
+        const NodeKind kind;
+        Type valueType = Type::UNKNOWN; // static type of an expression, set by the semantic analyzer
+
+        explicit ASTNode(NodeKind kind) : kind(kind) {}
 };
 
+// Checked downcast: returns nullptr when `node` is not a T.
+template <typename T>
+T* ast_cast(ASTNode* node) {
+    return node && node->kind == T::KIND ? static_cast<T*>(node) : nullptr;
+}
+
+template <typename T>
+const T* ast_cast(const ASTNode* node) {
+    return node && node->kind == T::KIND ? static_cast<const T*>(node) : nullptr;
+}
+
 class ReturnNode : public ASTNode {
     public:
-        std::unique_ptr<ASTNode> returnExpression;
+        static constexpr NodeKind KIND = NodeKind::Return;
+
+        AstPtr<ASTNode> returnExpression;
         int line, col;
     
         ReturnNode(
-            std::unique_ptr<ASTNode> returnExpression, int line, int col
-        ) : returnExpression(std::move(returnExpression)), line(line), col(col) {}
+            AstPtr<ASTNode> returnExpression, int line, int col
+        ) : ASTNode(KIND), returnExpression(std::move(returnExpression)), line(line), col(col) {}
 };
 
 
 class VariableNode : public ASTNode {
     public:
-        std::string name;
+        static constexpr NodeKind KIND = NodeKind::Variable;
+
+        Symbol name;
         int line, col;
+
+        // Resolved by the semantic analyzer: the scope level of the
+        // declaration within its function and its frame slot.
+        int depth = -1;
+        int slot = -1;
     
-        VariableNode(const std::string& name, int line, int col)
-            : name(name), line(line), col(col) {}
+        VariableNode(Symbol name, int line, int col)
+            : ASTNode(KIND), name(name), line(line), col(col) {}
 };
 
 class DeclarationNode : public ASTNode {
     public:
-        TokenType type; // NUMBER or STRING
-        std::vector<std::unique_ptr<VarDeclareNode>> declarations;
+        static constexpr NodeKind KIND = NodeKind::Declaration;
+
+        TokenType type; // NUMBER, STRING or NUMBER_ARRAY
+        std::vector<AstPtr<VarDeclareNode>> declarations;
     
-        DeclarationNode(TokenType type, std::vector<std::unique_ptr<VarDeclareNode>> declarations)
-            : type(type), declarations(std::move(declarations)) {}
+        DeclarationNode(TokenType type, std::vector<AstPtr<VarDeclareNode>> declarations)
+            : ASTNode(KIND), type(type), declarations(std::move(declarations)) {}
     };
     
 
 class VarDeclareNode : public ASTNode {
     public:
+        static constexpr NodeKind KIND = NodeKind::VarDeclare;
+
         TokenType type;
         Token name;
-        std::unique_ptr<ASTNode> initializer;
+        AstPtr<ASTNode> initializer;
+        int slot = -1; // frame slot, assigned by the semantic analyzer
     
-        VarDeclareNode(TokenType type, Token name, std::unique_ptr<ASTNode> initializer)
-            : type(type), name(name), initializer(std::move(initializer)) {}
+        VarDeclareNode(TokenType type, Token name, AstPtr<ASTNode> initializer)
+            : ASTNode(KIND), type(type), name(name), initializer(std::move(initializer)) {}
 };
     
 
 class NumberLiteralNode : public ASTNode {
     public:
+        static constexpr NodeKind KIND = NodeKind::NumberLiteral;
+
         std::string value;
         int line, col;
-        NumberLiteralNode(std::string value, int line, int col) : value(value), line(line), col(col) {}
+        NumberLiteralNode(std::string value, int line, int col) : ASTNode(KIND), value(value), line(line), col(col) {}
 };
 
 class StringLiteralNode : public ASTNode {
     public:
-        std::string value;
+        static constexpr NodeKind KIND = NodeKind::StringLiteral;
+
+        Symbol value;
         int line, col;
-        StringLiteralNode(std::string value, int line, int col) : value(value), line(line), col(col) {}
+        StringLiteralNode(Symbol value, int line, int col) : ASTNode(KIND), value(value), line(line), col(col) {}
 };
 
 class IfStatementNode : public ASTNode {
     public:
+        static constexpr NodeKind KIND = NodeKind::IfStatement;
+
 
-        std::vector<std::pair<std::unique_ptr<ASTNode>, std::unique_ptr<ASTNode>>> conditionBlocks;
-        std::unique_ptr<ASTNode> elseBranch;
+        std::vector<std::pair<AstPtr<ASTNode>, AstPtr<ASTNode>>> conditionBlocks;
+        AstPtr<ASTNode> elseBranch;
         int line, col;
 
         IfStatementNode(
-            std::vector<std::pair<std::unique_ptr<ASTNode>, std::unique_ptr<ASTNode>>> conditionBlocks,
-            std::unique_ptr<ASTNode> elseBranch,
+            std::vector<std::pair<AstPtr<ASTNode>, AstPtr<ASTNode>>> conditionBlocks,
+            AstPtr<ASTNode> elseBranch,
             int line, int col
-        ) : conditionBlocks(std::move(conditionBlocks)),
+        ) : ASTNode(KIND), conditionBlocks(std::move(conditionBlocks)),
             elseBranch(std::move(elseBranch)),
             line(line), col(col) {}
 };
@@ -105,14 +192,16 @@ class IfStatementNode : public ASTNode {
 
 class ComparisonNode : public ASTNode {
     public:
-        std::unique_ptr<ASTNode> leftExpression, rightExpression;
+        static constexpr NodeKind KIND = NodeKind::Comparison;
+
+        AstPtr<ASTNode> leftExpression, rightExpression;
         TokenType op;
         int line, col;
 
         ComparisonNode(
-            std::unique_ptr<ASTNode> leftExpression, std::unique_ptr<ASTNode> rightExpression,
+            AstPtr<ASTNode> leftExpression, AstPtr<ASTNode> rightExpression,
             TokenType op, int line, int col
-        ) : leftExpression(std::move(leftExpression)), rightExpression(std::move(rightExpression)), op(op), line(line), col(col) {}
+        ) : ASTNode(KIND), leftExpression(std::move(leftExpression)), rightExpression(std::move(rightExpression)), op(op), line(line), col(col) {}
     
 };
 
@@ -120,29 +209,33 @@ class ComparisonNode : public ASTNode {
 
 class LogicalExprNode : public ASTNode {
     public:
-        std::unique_ptr<ASTNode> leftExpression, rightExpression;
+        static constexpr NodeKind KIND = NodeKind::LogicalExpr;
+
+        AstPtr<ASTNode> leftExpression, rightExpression;
         TokenType op;
         int line, col;
 
         LogicalExprNode(
-            std::unique_ptr<ASTNode> leftExpression, std::unique_ptr<ASTNode> rightExpression,
+            AstPtr<ASTNode> leftExpression, AstPtr<ASTNode> rightExpression,
             TokenType op, int line, int col
-        ) : leftExpression(std::move(leftExpression)), rightExpression(std::move(rightExpression)), op(op), line(line), col(col) {}
+        ) : ASTNode(KIND), leftExpression(std::move(leftExpression)), rightExpression(std::move(rightExpression)), op(op), line(line), col(col) {}
 };
 
 class BinaryExprNode : public ASTNode {
     public:
-        std::unique_ptr<ASTNode> left, right;
+        static constexpr NodeKind KIND = NodeKind::BinaryExpr;
+
+        AstPtr<ASTNode> left, right;
         TokenType op;
         int line, col;
     
         BinaryExprNode(
-            std::unique_ptr<ASTNode> left,
-            std::unique_ptr<ASTNode> right,
+            AstPtr<ASTNode> left,
+            AstPtr<ASTNode> right,
             TokenType op,
             int line,
             int col
-        ) : left(std::move(left)),
+        ) : ASTNode(KIND), left(std::move(left)),
             right(std::move(right)),
             op(op),
             line(line),
@@ -151,16 +244,18 @@ class BinaryExprNode : public ASTNode {
 
 class UnaryExprNode : public ASTNode {
     public:
-        std::unique_ptr<ASTNode> operand;
+        static constexpr NodeKind KIND = NodeKind::UnaryExpr;
+
+        AstPtr<ASTNode> operand;
         TokenType op;
         int line, col;
     
         UnaryExprNode(
-            std::unique_ptr<ASTNode> operand,
+            AstPtr<ASTNode> operand,
             TokenType op,
             int line,
             int col
-        ) : operand(std::move(operand)),
+        ) : ASTNode(KIND), operand(std::move(operand)),
             op(op),
             line(line),
             col(col) {}
@@ -170,38 +265,55 @@ class UnaryExprNode : public ASTNode {
 
 class AssignmentNode : public ASTNode {
     public:
-        std::unique_ptr<ASTNode> left, rightExpression;
+        static constexpr NodeKind KIND = NodeKind::Assignment;
+
+        AstPtr<ASTNode> left, rightExpression;
         int line, col;
 
         AssignmentNode(
-            std::unique_ptr<ASTNode> left, std::unique_ptr<ASTNode> rightExpression, int line, int col
-        ) : left(std::move(left)), rightExpression(std::move(rightExpression)), line(line), col(col) {}
+            AstPtr<ASTNode> left, AstPtr<ASTNode> rightExpression, int line, int col
+        ) : ASTNode(KIND), left(std::move(left)), rightExpression(std::move(rightExpression)), line(line), col(col) {}
 };
 
 
 
 class PrintNode : public ASTNode {
     public:
-        std::unique_ptr<ASTNode> expression;
+        static constexpr NodeKind KIND = NodeKind::Print;
+
+        AstPtr<ASTNode> expression;
         int line, col;
     
-        PrintNode(std::unique_ptr<ASTNode> expression, int line, int col)
-            : expression(std::move(expression)), line(line), col(col) {}
+        PrintNode(AstPtr<ASTNode> expression, int line, int col)
+            : ASTNode(KIND), expression(std::move(expression)), line(line), col(col) {}
 };
 
 class FunctionNode : public ASTNode {
     public:
-        std::string name;
-        std::vector<std::pair<std::string, std::string>> parameters;
-        std::unique_ptr<ASTNode> functionBlock;
+        static constexpr NodeKind KIND = NodeKind::Function;
+
+        Symbol name;
+        std::vector<std::pair<std::string, Symbol>> parameters; // (type, name)
+        AstPtr<ASTNode> functionBlock;
         int line, col;
 
+        // Number of frame slots the body needs, set by the semantic analyzer.
+        // Parameters always occupy slots 0 .. parameters.size() - 1.
+        int frameSize = 0;
+
+        // Also set by the analyzer. A pure body prints nothing, writes to no
+        // array and calls only pure functions; a memoizable one is pure, takes
+        // only numbers and returns a number, so a call can be answered from
+        // earlier calls.
+        bool pure = false;
+        bool memoizable = false;
+
         FunctionNode(
-            const std::string& name,
-            std::vector<std::pair<std::string, std::string>> parameters,
-            std::unique_ptr<ASTNode> functionBlock,
+            Symbol name,
+            std::vector<std::pair<std::string, Symbol>> parameters,
+            AstPtr<ASTNode> functionBlock,
             int line, int col
-        ) : name(name),
+        ) : ASTNode(KIND), name(name),
             parameters(std::move(parameters)),
             functionBlock(std::move(functionBlock)),
             line(line), col(col) {}
@@ -210,16 +322,19 @@ class FunctionNode : public ASTNode {
 
 class CallExprNode : public ASTNode {
     public:
-        std::string functionName;
-        std::vector<std::unique_ptr<ASTNode>> arguments;
+        static constexpr NodeKind KIND = NodeKind::CallExpr;
+
+        Symbol functionName;
+        std::vector<AstPtr<ASTNode>> arguments;
         int line, col;
+        Builtin builtin = Builtin::NONE; // set by the semantic analyzer
     
         CallExprNode(
-            const std::string& functionName,
-            std::vector<std::unique_ptr<ASTNode>> arguments,
+            Symbol functionName,
+            std::vector<AstPtr<ASTNode>> arguments,
             int line,
             int col
-        ) : functionName(functionName),
+        ) : ASTNode(KIND), functionName(functionName),
             arguments(std::move(arguments)),
             line(line),
             col(col) {}
@@ -229,24 +344,53 @@ class CallExprNode : public ASTNode {
 
 class WhileNode : public ASTNode {
     public:
-        std::unique_ptr<ASTNode> conditionStatement, whileBlock;
+        static constexpr NodeKind KIND = NodeKind::While;
+
+        AstPtr<ASTNode> conditionStatement, whileBlock;
         int line, col;
 
         WhileNode(
-            std::unique_ptr<ASTNode> conditionStatement,
-            std::unique_ptr<ASTNode> whileBlock,
+            AstPtr<ASTNode> conditionStatement,
+            AstPtr<ASTNode> whileBlock,
             int line, int col
-        ) : conditionStatement(std::move(conditionStatement)),
+        ) : ASTNode(KIND), conditionStatement(std::move(conditionStatement)),
             whileBlock(std::move(whileBlock)),
             line(line), col(col) {}
 };
     
 class BlockNode : public ASTNode {
     public:
-        std::vector<std::unique_ptr<ASTNode>> statements;
+        static constexpr NodeKind KIND = NodeKind::Block;
+
+        std::vector<AstPtr<ASTNode>> statements;
         int line, col;
     
-        BlockNode(std::vector<std::unique_ptr<ASTNode>> statements, int line, int col)
-            : statements(std::move(statements)), line(line), col(col) {}
+        BlockNode(std::vector<AstPtr<ASTNode>> statements, int line, int col)
+            : ASTNode(KIND), statements(std::move(statements)), line(line), col(col) {}
+};
+
+
+// number[size]: a new array of `size` zeros.
+class ArrayAllocNode : public ASTNode {
+    public:
+        static constexpr NodeKind KIND = NodeKind::ArrayAlloc;
+
+        AstPtr<ASTNode> size;
+        int line, col;
+
+        ArrayAllocNode(AstPtr<ASTNode> size, int line, int col)
+            : ASTNode(KIND), size(std::move(size)), line(line), col(col) {}
+};
+
+// array[index], read in an expression or written as an assignment target.
+class IndexNode : public ASTNode {
+    public:
+        static constexpr NodeKind KIND = NodeKind::Index;
+
+        AstPtr<ASTNode> array, index;
+        int line, col;
+
+        IndexNode(AstPtr<ASTNode> array, AstPtr<ASTNode> index, int line, int col)
+            : ASTNode(KIND), array(std::move(array)), index(std::move(index)), line(line), col(col) {}
 };
 
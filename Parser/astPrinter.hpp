@@ -15,122 +15,168 @@ void printAST(const ASTNode* node, int indent) {
         return;
     }
 
-    if (auto num = dynamic_cast<const NumberLiteralNode*>(node)) {
-        printIndent(indent);
-        std::cout << "NumberLiteral(" << num->value << ")\n";
-    }
-    else if (auto str = dynamic_cast<const StringLiteralNode*>(node)) {
-        printIndent(indent);
-        std::cout << "StringLiteral(\"" << str->value << "\")\n";
-    }
-    else if (auto var = dynamic_cast<const VariableNode*>(node)) {
-        printIndent(indent);
-        std::cout << "Variable(" << var->name << ")\n";
-    }
-    else if (auto bin = dynamic_cast<const BinaryExprNode*>(node)) {
-        printIndent(indent);
-        std::cout << "BinaryExpr(" << (int)bin->op << ")\n";
-        printAST(bin->left.get(), indent + 1);
-        printAST(bin->right.get(), indent + 1);
-    }
-    else if (auto cmp = dynamic_cast<const ComparisonNode*>(node)) {
-        printIndent(indent);
-        std::cout << "Comparison(";
-    
-        // Pretty-print the operator
-        switch (cmp->op) {
-            case TokenType::EQ: std::cout << "=="; break;
-            case TokenType::NEQ: std::cout << "!="; break;
-            case TokenType::LT: std::cout << "<"; break;
-            case TokenType::GT: std::cout << ">"; break;
-            case TokenType::LEQ: std::cout << "<="; break;
-            case TokenType::GEQ: std::cout << ">="; break;
-            default: std::cout << "UnknownOp"; break;
+    switch (node->kind) {
+        case NodeKind::NumberLiteral: {
+            auto num = static_cast<const NumberLiteralNode*>(node);
+            printIndent(indent);
+            std::cout << "NumberLiteral(" << num->value << ")\n";
+            break;
+        }
+        case NodeKind::StringLiteral: {
+            auto str = static_cast<const StringLiteralNode*>(node);
+            printIndent(indent);
+            std::cout << "StringLiteral(\"" << symbolName(str->value) << "\")\n";
+            break;
+        }
+        case NodeKind::Variable: {
+            auto var = static_cast<const VariableNode*>(node);
+            printIndent(indent);
+            std::cout << "Variable(" << symbolName(var->name) << ")\n";
+            break;
         }
+        case NodeKind::BinaryExpr: {
+            auto bin = static_cast<const BinaryExprNode*>(node);
+            printIndent(indent);
+            std::cout << "BinaryExpr(" << (int)bin->op << ")\n";
+            printAST(bin->left.get(), indent + 1);
+            printAST(bin->right.get(), indent + 1);
+            break;
+        }
+        case NodeKind::Comparison: {
+            auto cmp = static_cast<const ComparisonNode*>(node);
+            printIndent(indent);
+            std::cout << "Comparison(";
     
-        std::cout << ")\n";
-        printAST(cmp->leftExpression.get(), indent + 1);
-        printAST(cmp->rightExpression.get(), indent + 1);
-    }
+            // Pretty-print the operator
+            switch (cmp->op) {
+                case TokenType::EQ: std::cout << "=="; break;
+                case TokenType::NEQ: std::cout << "!="; break;
+                case TokenType::LT: std::cout << "<"; break;
+                case TokenType::GT: std::cout << ">"; break;
+                case TokenType::LEQ: std::cout << "<="; break;
+                case TokenType::GEQ: std::cout << ">="; break;
+                default: std::cout << "UnknownOp"; break;
+            }
     
-    else if (auto assign = dynamic_cast<const AssignmentNode*>(node)) {
-        printIndent(indent);
-        std::cout << "Assignment\n";
-        printAST(assign->left.get(), indent + 1);
-        printAST(assign->rightExpression.get(), indent + 1);
-    }
-    else if (auto decl = dynamic_cast<const DeclarationNode*>(node)) {
-        printIndent(indent);
-        std::cout << "Declaration(" << (decl->type == TokenType::NUMBER ? "number" : "string") << ")\n";
-        for (const auto& d : decl->declarations)
-            printAST(d.get(), indent + 1);
-    }
-    else if (auto vardecl = dynamic_cast<const VarDeclareNode*>(node)) {
-        printIndent(indent);
-        std::cout << "VarDeclare(" << vardecl->name.value << ")\n";
-        if (vardecl->initializer)
-            printAST(vardecl->initializer.get(), indent + 1);
-    }
-    else if (auto ret = dynamic_cast<const ReturnNode*>(node)) {
-        printIndent(indent);
-        std::cout << "Return\n";
-        printAST(ret->returnExpression.get(), indent + 1);
-    }
-    else if (auto print = dynamic_cast<const PrintNode*>(node)) {
-        printIndent(indent);
-        std::cout << "Print\n";
-        printAST(print->expression.get(), indent + 1);
-    }
-    else if (auto block = dynamic_cast<const BlockNode*>(node)) {
-        printIndent(indent);
-        std::cout << "Block\n";
-        for (const auto& stmt : block->statements)
-            printAST(stmt.get(), indent + 1);
-    }
-    else if (auto func = dynamic_cast<const FunctionNode*>(node)) {
-        printIndent(indent);
-        std::cout << "Function(" << func->name << ")\n";
-        for (const auto& [type, name] : func->parameters) {
-            printIndent(indent + 1);
-            std::cout << "Param(" << type << " " << name << ")\n";
+            std::cout << ")\n";
+            printAST(cmp->leftExpression.get(), indent + 1);
+            printAST(cmp->rightExpression.get(), indent + 1);
+            break;
         }
-        printAST(func->functionBlock.get(), indent + 1);
-    }
-    else if (auto call = dynamic_cast<const CallExprNode*>(node)) {
-        printIndent(indent);
-        std::cout << "Call(" << call->functionName << ")\n";
-        for (const auto& arg : call->arguments)
-            printAST(arg.get(), indent + 1);
-    }
-    else if (auto ifstmt = dynamic_cast<const IfStatementNode*>(node)) {
-        printIndent(indent);
-        std::cout << "IfStatement\n";
-        for (const auto& [cond, block] : ifstmt->conditionBlocks) {
+        case NodeKind::Assignment: {
+            auto assign = static_cast<const AssignmentNode*>(node);
+            printIndent(indent);
+            std::cout << "Assignment\n";
+            printAST(assign->left.get(), indent + 1);
+            printAST(assign->rightExpression.get(), indent + 1);
+            break;
+        }
+        case NodeKind::Declaration: {
+            auto decl = static_cast<const DeclarationNode*>(node);
+            printIndent(indent);
+            std::cout << "Declaration(" << (decl->type == TokenType::NUMBER ? "number" : decl->type == TokenType::NUMBER_ARRAY ? "number[]" : "string") << ")\n";
+            for (const auto& d : decl->declarations)
+                printAST(d.get(), indent + 1);
+            break;
+        }
+        case NodeKind::VarDeclare: {
+            auto vardecl = static_cast<const VarDeclareNode*>(node);
+            printIndent(indent);
+            std::cout << "VarDeclare(" << vardecl->name.value << ")\n";
+            if (vardecl->initializer)
+                printAST(vardecl->initializer.get(), indent + 1);
+            break;
+        }
+        case NodeKind::Return: {
+            auto ret = static_cast<const ReturnNode*>(node);
+            printIndent(indent);
+            std::cout << "Return\n";
+            printAST(ret->returnExpression.get(), indent + 1);
+            break;
+        }
+        case NodeKind::Print: {
+            auto print = static_cast<const PrintNode*>(node);
+            printIndent(indent);
+            std::cout << "Print\n";
+            printAST(print->expression.get(), indent + 1);
+            break;
+        }
+        case NodeKind::Block: {
+            auto block = static_cast<const BlockNode*>(node);
+            printIndent(indent);
+            std::cout << "Block\n";
+            for (const auto& stmt : block->statements)
+                printAST(stmt.get(), indent + 1);
+            break;
+        }
+        case NodeKind::Function: {
+            auto func = static_cast<const FunctionNode*>(node);
+            printIndent(indent);
+            std::cout << "Function(" << symbolName(func->name) << ")\n";
+            for (const auto& [type, name] : func->parameters) {
+                printIndent(indent + 1);
+                std::cout << "Param(" << type << " " << symbolName(name) << ")\n";
+            }
+            printAST(func->functionBlock.get(), indent + 1);
+            break;
+        }
+        case NodeKind::CallExpr: {
+            auto call = static_cast<const CallExprNode*>(node);
+            printIndent(indent);
+            std::cout << "Call(" << symbolName(call->functionName) << ")\n";
+            for (const auto& arg : call->arguments)
+                printAST(arg.get(), indent + 1);
+            break;
+        }
+        case NodeKind::IfStatement: {
+            auto ifstmt = static_cast<const IfStatementNode*>(node);
+            printIndent(indent);
+            std::cout << "IfStatement\n";
+            for (const auto& [cond, block] : ifstmt->conditionBlocks) {
+                printIndent(indent + 1);
+                std::cout << "Condition:\n";
+                printAST(cond.get(), indent + 2);
+                printIndent(indent + 1);
+                std::cout << "Block:\n";
+                printAST(block.get(), indent + 2);
+            }
+            if (ifstmt->elseBranch) {
+                printIndent(indent + 1);
+                std::cout << "Else:\n";
+                printAST(ifstmt->elseBranch.get(), indent + 2);
+            }
+            break;
+        }
+        case NodeKind::While: {
+            auto whilestmt = static_cast<const WhileNode*>(node);
+            printIndent(indent);
+            std::cout << "While\n";
             printIndent(indent + 1);
             std::cout << "Condition:\n";
-            printAST(cond.get(), indent + 2);
+            printAST(whilestmt->conditionStatement.get(), indent + 2);
             printIndent(indent + 1);
             std::cout << "Block:\n";
-            printAST(block.get(), indent + 2);
+            printAST(whilestmt->whileBlock.get(), indent + 2);
+            break;
         }
-        if (ifstmt->elseBranch) {
-            printIndent(indent + 1);
-            std::cout << "Else:\n";
-            printAST(ifstmt->elseBranch.get(), indent + 2);
+        case NodeKind::ArrayAlloc: {
+            auto alloc = static_cast<const ArrayAllocNode*>(node);
+            printIndent(indent);
+            std::cout << "ArrayAlloc\n";
+            printAST(alloc->size.get(), indent + 1);
+            break;
         }
-    }
-    else if (auto whilestmt = dynamic_cast<const WhileNode*>(node)) {
-        printIndent(indent);
-        std::cout << "While\n";
-        printIndent(indent + 1);
-        std::cout << "Condition:\n";
-        printAST(whilestmt->conditionStatement.get(), indent + 2);
-        printIndent(indent + 1);
-        std::cout << "Block:\n";
-        printAST(whilestmt->whileBlock.get(), indent + 2);
-    }
-    else {
-        printIndent(indent);
-        std::cout << "Unknown AST Node\n";
+        case NodeKind::Index: {
+            auto index = static_cast<const IndexNode*>(node);
+            printIndent(indent);
+            std::cout << "Index\n";
+            printAST(index->array.get(), indent + 1);
+            printAST(index->index.get(), indent + 1);
+            break;
+        }
+        default:
+            printIndent(indent);
+            std::cout << "Unknown AST Node\n";
+            break;
     }
 }
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+    Non-owning handle to a node living in an AstArena. It mirrors the parts of
+    std::unique_ptr the later phases use (get, ->, *, bool tests, std::move),
+    so code written against unique_ptr keeps compiling. Ownership stays with
+    the arena: handles never delete anything.
+*/
+template <typename T>
+class AstPtr {
+public:
+    AstPtr() = default;
+    AstPtr(std::nullptr_t) {}
+    explicit AstPtr(T *ptr) : ptr(ptr) {}
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+    AstPtr(const AstPtr<U> &other) : ptr(other.get()) {}
+
+    T *get() const { return ptr; }
+    T *operator->() const { return ptr; }
+    T &operator*() const { return *ptr; }
+    explicit operator bool() const { return ptr != nullptr; }
+
+    bool operator==(std::nullptr_t) const { return ptr == nullptr; }
+    bool operator!=(std::nullptr_t) const { return ptr != nullptr; }
+
+private:
+    T *ptr = nullptr;
+};
+
+/*
+    Bump allocator for AST nodes. Nodes are carved out of large blocks and are
+    all released together when the arena goes away. Destructors run in a flat
+    loop in reverse allocation order, so tearing down a deeply nested tree
+    never recurses.
+*/
+class AstArena {
+public:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    AstArena() = default;
+    AstArena(const AstArena &) = delete;
+    AstArena &operator=(const AstArena &) = delete;
+
+    ~AstArena() {
+        for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+            it->second(it->first);
+        }
+    }
+
+    template <typename T, typename... Args>
+    AstPtr<T> make(Args &&...args) {
+        void *memory = allocate(sizeof(T), alignof(T));
+        T *node = new (memory) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            destructors.emplace_back(node, [](void *p) { static_cast<T *>(p)->~T(); });
+        }
+        nodes++;
+        return AstPtr<T>(node);
+    }
+
+    size_t bytesAllocated() const { return used; }
+    size_t nodeCount() const { return nodes; }
+
+private:
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte *cursor = nullptr;
+    size_t remaining = 0;
+    size_t used = 0;
+    size_t nodes = 0;
+    std::vector<std::pair<void *, void (*)(void *)>> destructors;
+
+    void *allocate(size_t size, size_t align) {
+        size_t padding = cursor ? (align - reinterpret_cast<uintptr_t>(cursor) % align) % align : 0;
+        if (!cursor || padding + size > remaining) {
+            size_t blockSize = size + align > BLOCK_SIZE ? size + align : BLOCK_SIZE;
+            blocks.emplace_back(new std::byte[blockSize]); // left uninitialised on purpose
+            cursor = blocks.back().get();
+            remaining = blockSize;
+            padding = (align - reinterpret_cast<uintptr_t>(cursor) % align) % align;
+        }
+        std::byte *result = cursor + padding;
+        cursor = result + size;
+        remaining -= padding + size;
+        used += size;
+        return result;
+    }
+};
@@ -16,12 +16,13 @@ Statement       ::= Declaration
 ReturnStatement ::= RETURN Expression SEMICOLON
 
 (* Variable Declaration *)
-Declaration     ::= ( NUMBER | STRING ) VarList SEMICOLON
+Declaration     ::= Type VarList SEMICOLON
+Type            ::= NUMBER | STRING | NUMBER_ARRAY
 VarList         ::= ( IDENTIFIER [ ASSIGN Expression ] )
                   { COMMA IDENTIFIER [ ASSIGN Expression ] }
 
-(* Assignment *)
-Assignment      ::= IDENTIFIER ASSIGN Expression SEMICOLON
+(* Assignment, to a variable or to one element of an array *)
+Assignment      ::= IDENTIFIER [ LBRACKET Expression RBRACKET ] ASSIGN Expression SEMICOLON
 
 (* If / Elif / Else *)
 IfStatement     ::= IF LPAREN Expression RPAREN Statement
@@ -33,8 +34,8 @@ WhileLoop       ::= WHILE LPAREN Expression RPAREN Statement
 
 (* Function Declaration *)
 FunctionDecl    ::= FUNC IDENTIFIER LPAREN [ ParameterList ] RPAREN Block
-ParameterList   ::= ( (NUMBER | STRING) IDENTIFIER )
-                    { COMMA (NUMBER | STRING) IDENTIFIER }
+ParameterList   ::= ( Type IDENTIFIER )
+                    { COMMA Type IDENTIFIER }
 
 (* Print *)
 PrintStatement  ::= PRINT LPAREN Expression RPAREN SEMICOLON
@@ -42,7 +43,9 @@ PrintStatement  ::= PRINT LPAREN Expression RPAREN SEMICOLON
 (* Block *)
 Block           ::= LBRACE { Statement } RBRACE
 
-(* Expressions with full BODMAS + logical operators *)
+(* Expressions with full BODMAS + logical operators.
+   Parsed by precedence climbing over the binary operator table in
+   parseExpression; the ladder below documents the resulting precedence. *)
 Expression      ::= LogicalOr
 
 LogicalOr       ::= LogicalAnd { OR LogicalAnd }
@@ -53,11 +56,14 @@ Additive        ::= Term       { ( PLUS | MINUS ) Term }
 Term            ::= Factor     { ( MULTIPLY | DIVIDE ) Factor }
 Factor          ::= [ NOT | MINUS ] Primary
 
-Primary         ::= IDENTIFIER
+Primary         ::= ( IDENTIFIER | CallExpression ) { LBRACKET Expression RBRACKET }
                   | NUMBER_LITERAL
                   | STRING_LITERAL
                   | LPAREN Expression RPAREN
-                  | CallExpression
+                  | ArrayAlloc
+
+(* A new array of Expression zeros *)
+ArrayAlloc      ::= NUMBER LBRACKET Expression RBRACKET
 
 (* Function Call *)
 CallExpression  ::= IDENTIFIER LPAREN [ ArgumentList ] RPAREN
@@ -66,6 +72,7 @@ ArgumentList    ::= Expression { COMMA Expression }
 (* Lexical tokens – just for clarity, these are terminals *)
 NUMBER          ::= 'number'
 STRING          ::= 'string'
+NUMBER_ARRAY    ::= 'number[]'
 IDENTIFIER      ::= Letter { Letter | Digit | '_' }
 NUMBER_LITERAL  ::= Digit { Digit }
 STRING_LITERAL  ::= '"' { Character } '"'
@@ -74,6 +81,8 @@ LPAREN          ::= '('
 RPAREN          ::= ')'
 LBRACE          ::= '{'
 RBRACE          ::= '}'
+LBRACKET        ::= '['
+RBRACKET        ::= ']'
 COMMA           ::= ','
 SEMICOLON       ::= ';'
 
@@ -114,21 +123,67 @@ END_OF_FILE     ::= ↵
 #include <vector>
 #include <memory>
 
+std::ostream &operator<<(std::ostream &os, const ParseError &error)
+{
+    return os << "Parse Error [line " << error.line
+              << ", col " << error.col << "]: "
+              << error.message << "\n"
+              << " (Token: " << error.token << ")\n";
+}
+
 void Parser::reportError(const std::string &message)
 {
     const Token &token = peek();
-    std::cerr << "Parse Error [line " << token.line
-              << ", col " << token.column << "]: "
-              << message << "\n"
-              << " (Token: " << token.type << ")\n";
-              exit(1);
+    errors.push_back({token.line, token.column, token.type, message});
+    throw SyntaxError{};
 }
 
-Token Parser::peek() { return tokens[current]; }
-Token Parser::advance() { return tokens[current++]; }
-Token Parser::previous()
+/*
+    Panic-mode recovery: discard tokens up to and including the next ';', or
+    up to (not including) the next '}' so the enclosing block can close.
+*/
+void Parser::synchronize()
 {
-    return current != 0 ? tokens[current - 1] : Token(TokenType::UNKNOWN, "", -1, -1);
+    while (peek().type != TokenType::END_OF_FILE)
+    {
+        if (peek().type == TokenType::RBRACE)
+        {
+            return;
+        }
+        if (advance().type == TokenType::SEMICOLON)
+        {
+            return;
+        }
+    }
+}
+
+AstPtr<ASTNode> Parser::parseStatementOrRecover()
+{
+    try
+    {
+        return parseStatement();
+    }
+    catch (const SyntaxError &)
+    {
+        synchronize();
+        return nullptr;
+    }
+}
+
+const Token &Parser::peek() const { return tokens[current]; }
+const Token &Parser::advance()
+{
+    const Token &token = tokens[current];
+    if (token.type != TokenType::END_OF_FILE)
+    {
+        current++;
+    }
+    return token;
+}
+const Token &Parser::previous() const
+{
+    static const Token none(TokenType::UNKNOWN, "", -1, -1);
+    return current != 0 ? tokens[current - 1] : none;
 }
 
 bool Parser::match(TokenType type)
@@ -151,7 +206,7 @@ bool Parser::match(TokenType type)
                   | ReturnStatement
 
 */
-std::unique_ptr<ASTNode> Parser::parseStatement()
+AstPtr<ASTNode> Parser::parseStatement()
 {
     if (match(TokenType::NUMBER))
     {
@@ -161,16 +216,20 @@ std::unique_ptr<ASTNode> Parser::parseStatement()
     {
         return parseDeclaration();
     }
+    else if (match(TokenType::NUMBER_ARRAY))
+    {
+        return parseDeclaration();
+    }
     else if (match(TokenType::IDENTIFIER))
     {
         Token identifierToken = previous(); 
-        if (peek().type == TokenType::ASSIGN)
+        if (peek().type == TokenType::ASSIGN || peek().type == TokenType::LBRACKET)
         {
             return parseAssignment();
         }
         else if (peek().type == TokenType::LPAREN)
         {
-            std::unique_ptr<ASTNode> callNode = parseCallExpression(identifierToken);
+            AstPtr<ASTNode> callNode = parseCallExpression(identifierToken);
             if (!match(TokenType::SEMICOLON))
             {
                 reportError("Expected ';' after function call statement");
@@ -216,9 +275,9 @@ std::unique_ptr<ASTNode> Parser::parseStatement()
 }
 
 /* ReturnStatement ::= RETURN Expression SEMICOLON */
-std::unique_ptr<ASTNode> Parser::parseReturnStatement()
+AstPtr<ASTNode> Parser::parseReturnStatement()
 {
-    std::unique_ptr<ASTNode> parsedExpression = parseExpression();
+    AstPtr<ASTNode> parsedExpression = parseExpression();
     Token previousToken = previous();
     if (!match(TokenType::SEMICOLON))
     {
@@ -226,7 +285,7 @@ std::unique_ptr<ASTNode> Parser::parseReturnStatement()
         return NULL;
     }
     // return parsedExpression;
-        return std::make_unique<ReturnNode>(
+        return arena.make<ReturnNode>(
         std::move(parsedExpression),
         previousToken.line,  // or current token's line
         previousToken.column    // or current token's col
@@ -235,17 +294,17 @@ std::unique_ptr<ASTNode> Parser::parseReturnStatement()
 
 /*
     (* Variable Declaration *)
-    Declaration     ::= ( NUMBER | STRING ) VarList SEMICOLON
+    Declaration     ::= ( NUMBER | STRING | NUMBER_ARRAY ) VarList SEMICOLON
     VarList         ::= ( IDENTIFIER [ ASSIGN Expression ] )
                       { COMMA IDENTIFIER [ ASSIGN Expression ] }
     */
 
-std::unique_ptr<ASTNode> Parser::parseDeclaration()
+AstPtr<ASTNode> Parser::parseDeclaration()
 {
 
     TokenType variableType = previous().type;
 
-    std::vector<std::unique_ptr<VarDeclareNode>> declarations = parseVarList(variableType);
+    std::vector<AstPtr<VarDeclareNode>> declarations = parseVarList(variableType);
 
     if (!match(TokenType::SEMICOLON))
     {
@@ -253,11 +312,11 @@ std::unique_ptr<ASTNode> Parser::parseDeclaration()
         return NULL;
     }
 
-    return std::make_unique<DeclarationNode>(variableType, std::move(declarations));
+    return arena.make<DeclarationNode>(variableType, std::move(declarations));
 }
-std::vector<std::unique_ptr<VarDeclareNode>> Parser::parseVarList(TokenType variableType)
+std::vector<AstPtr<VarDeclareNode>> Parser::parseVarList(TokenType variableType)
 {
-    std::vector<std::unique_ptr<VarDeclareNode>> varDeclareList;
+    std::vector<AstPtr<VarDeclareNode>> varDeclareList;
 
     if (!match(TokenType::IDENTIFIER)) {
         reportError("Invalid identifier");
@@ -265,13 +324,13 @@ std::vector<std::unique_ptr<VarDeclareNode>> Parser::parseVarList(TokenType vari
     }
 
     Token nameTok = previous();  // Keep full Token
-    std::unique_ptr<ASTNode> initExpr = nullptr;
+    AstPtr<ASTNode> initExpr = nullptr;
 
     if (match(TokenType::ASSIGN)) {
         initExpr = parseExpression();
     }
 
-    varDeclareList.push_back(std::make_unique<VarDeclareNode>(
+    varDeclareList.push_back(arena.make<VarDeclareNode>(
         variableType, nameTok, std::move(initExpr)));
 
     while (match(TokenType::COMMA)) {
@@ -281,13 +340,13 @@ std::vector<std::unique_ptr<VarDeclareNode>> Parser::parseVarList(TokenType vari
         }
 
         Token nextNameTok = previous();
-        std::unique_ptr<ASTNode> additionalExprs = nullptr;
+        AstPtr<ASTNode> additionalExprs = nullptr;
 
         if (match(TokenType::ASSIGN)) {
             additionalExprs = parseExpression();
         }
 
-        varDeclareList.push_back(std::make_unique<VarDeclareNode>(
+        varDeclareList.push_back(arena.make<VarDeclareNode>(
             variableType, nextNameTok, std::move(additionalExprs)));
     }
 
@@ -297,21 +356,25 @@ std::vector<std::unique_ptr<VarDeclareNode>> Parser::parseVarList(TokenType vari
 
 /*
     (* Assignment *)
-Assignment      ::= IDENTIFIER ASSIGN Expression SEMICOLON
+Assignment      ::= IDENTIFIER [ LBRACKET Expression RBRACKET ] ASSIGN Expression SEMICOLON
 
 */
 
-std::unique_ptr<ASTNode> Parser::parseAssignment()
+AstPtr<ASTNode> Parser::parseAssignment()
 {
     Token idTok = previous();
-    Token c = peek();
+    AstPtr<ASTNode> target = arena.make<VariableNode>(idTok.symbol, idTok.line, idTok.column);
+    if (match(TokenType::LBRACKET))
+    {
+        target = parseIndex(std::move(target));
+    }
     if (!match(TokenType::ASSIGN))
     {
         reportError("= symbol not found");
         return nullptr;
     }
 
-    std::unique_ptr<ASTNode> rightExpression = parseExpression();
+    AstPtr<ASTNode> rightExpression = parseExpression();
 
     if (!match(TokenType::SEMICOLON))
     {
@@ -319,8 +382,8 @@ std::unique_ptr<ASTNode> Parser::parseAssignment()
         return nullptr;
     }
 
-    return std::make_unique<AssignmentNode>(
-        std::make_unique<VariableNode>(idTok.value, idTok.line, idTok.column),
+    return arena.make<AssignmentNode>(
+        std::move(target),
         std::move(rightExpression),
         idTok.line,
         idTok.column);
@@ -335,35 +398,35 @@ IfStatement     ::= IF LPAREN Expression RPAREN Statement
 
 */
 
-std::unique_ptr<ASTNode> Parser::parseIfStatement()
+AstPtr<ASTNode> Parser::parseIfStatement()
 {
     Token ifToken = previous();
 
-    std::vector<std::pair<std::unique_ptr<ASTNode>, std::unique_ptr<ASTNode>>> conditionBlocks;
+    std::vector<std::pair<AstPtr<ASTNode>, AstPtr<ASTNode>>> conditionBlocks;
 
-    std::unique_ptr<ASTNode> condition = parseExpression();
+    AstPtr<ASTNode> condition = parseExpression();
     if (!match(TokenType::LBRACE))
     {
         reportError("Expected '{' after if condition");
         return NULL;
     }
-    std::unique_ptr<ASTNode> ifBlock = parseBlock();
+    AstPtr<ASTNode> ifBlock = parseBlock();
     conditionBlocks.push_back({std::move(condition), std::move(ifBlock)});
     // For elif blocks
     while (match(TokenType::ELIF))
     {
-        std::unique_ptr<ASTNode> elifCondition = parseExpression();
+        AstPtr<ASTNode> elifCondition = parseExpression();
         if (!match(TokenType::LBRACE))
         {
             reportError("Expected '{' after elif condition");
             return NULL;
         }
-        std::unique_ptr<ASTNode> elifBlock = parseBlock();
+        AstPtr<ASTNode> elifBlock = parseBlock();
         conditionBlocks.push_back({std::move(elifCondition), std::move(elifBlock)});
     }
 
     // For else block
-    std::unique_ptr<ASTNode> elseBranch = nullptr;
+    AstPtr<ASTNode> elseBranch = nullptr;
     if (match(TokenType::ELSE))
     {
         if (!match(TokenType::LBRACE))
@@ -374,7 +437,7 @@ std::unique_ptr<ASTNode> Parser::parseIfStatement()
         elseBranch = parseBlock();
     }
 
-    return std::make_unique<IfStatementNode>(
+    return arena.make<IfStatementNode>(
         std::move(conditionBlocks),
         std::move(elseBranch),
         ifToken.line,
@@ -385,7 +448,7 @@ std::unique_ptr<ASTNode> Parser::parseIfStatement()
 WhileLoop       ::= WHILE LPAREN Expression RPAREN Statement
 */
 
-std::unique_ptr<ASTNode> Parser::parseWhileLoop()
+AstPtr<ASTNode> Parser::parseWhileLoop()
 {
     Token whileTok = previous();
 
@@ -405,7 +468,7 @@ std::unique_ptr<ASTNode> Parser::parseWhileLoop()
 
     auto bodyStmt = parseStatement();
 
-    return std::make_unique<WhileNode>(
+    return arena.make<WhileNode>(
         std::move(conditionExpr),
         std::move(bodyStmt),
         whileTok.line,
@@ -415,17 +478,17 @@ std::unique_ptr<ASTNode> Parser::parseWhileLoop()
 /*
 (* Function Declaration *)
 FunctionDecl    ::= FUNC IDENTIFIER LPAREN [ ParameterList ] RPAREN Block
-ParameterList   ::= ( (NUMBER | STRING) IDENTIFIER )
-                    { COMMA (NUMBER | STRING) IDENTIFIER }
+ParameterList   ::= ( (NUMBER | STRING | NUMBER_ARRAY) IDENTIFIER )
+                    { COMMA (NUMBER | STRING | NUMBER_ARRAY) IDENTIFIER }
 
 */
 
-std::vector<std::pair<std::string, std::string>> Parser::parseParameterList()
+std::vector<std::pair<std::string, Symbol>> Parser::parseParameterList()
 {
-    std::vector<std::pair<std::string, std::string>> params;
+    std::vector<std::pair<std::string, Symbol>> params;
 
-    if (!(match(TokenType::NUMBER) || match(TokenType::STRING))) {
-        reportError("Expected parameter type 'number' or 'string'");
+    if (!(match(TokenType::NUMBER) || match(TokenType::STRING) || match(TokenType::NUMBER_ARRAY))) {
+        reportError("Expected parameter type 'number', 'string' or 'number[]'");
         return params;
     }
     Token typeTok = previous();
@@ -436,10 +499,10 @@ std::vector<std::pair<std::string, std::string>> Parser::parseParameterList()
     }
     Token nameTok = previous();
 
-    params.emplace_back(typeTok.value, nameTok.value);
+    params.emplace_back(typeTok.value, nameTok.symbol);
 
     while (match(TokenType::COMMA)) {
-        if (!(match(TokenType::NUMBER) || match(TokenType::STRING))) {
+        if (!(match(TokenType::NUMBER) || match(TokenType::STRING) || match(TokenType::NUMBER_ARRAY))) {
             reportError("Expected parameter type after ','");
             break;
         }
@@ -451,14 +514,14 @@ std::vector<std::pair<std::string, std::string>> Parser::parseParameterList()
         }
         nameTok = previous();
 
-        params.emplace_back(typeTok.value, nameTok.value);
+        params.emplace_back(typeTok.value, nameTok.symbol);
     }
 
     return params;
 }
 
 
-std::unique_ptr<ASTNode> Parser::parseFunctionDecl()
+AstPtr<ASTNode> Parser::parseFunctionDecl()
 {
     Token funcTok = previous();
 
@@ -475,7 +538,7 @@ std::unique_ptr<ASTNode> Parser::parseFunctionDecl()
         return nullptr;
     }
 
-    std::vector<std::pair<std::string, std::string>> params;
+    std::vector<std::pair<std::string, Symbol>> params;
     if (peek().type != TokenType::RPAREN)
     {
         params = parseParameterList();
@@ -494,8 +557,8 @@ std::unique_ptr<ASTNode> Parser::parseFunctionDecl()
     }
     auto body = parseBlock();
 
-    return std::make_unique<FunctionNode>(
-        nameTok.value,
+    return arena.make<FunctionNode>(
+        nameTok.symbol,
         std::move(params),
         std::move(body),
         funcTok.line,
@@ -507,7 +570,7 @@ std::unique_ptr<ASTNode> Parser::parseFunctionDecl()
 PrintStatement  ::= PRINT LPAREN Expression RPAREN SEMICOLON
 */
 
-std::unique_ptr<ASTNode> Parser::parsePrintStatement()
+AstPtr<ASTNode> Parser::parsePrintStatement()
 {
     Token printTok = previous();
 
@@ -531,7 +594,7 @@ std::unique_ptr<ASTNode> Parser::parsePrintStatement()
         return nullptr;
     }
 
-    return std::make_unique<PrintNode>(
+    return arena.make<PrintNode>(
         std::move(expr),
         printTok.line,
         printTok.column);
@@ -541,18 +604,25 @@ std::unique_ptr<ASTNode> Parser::parsePrintStatement()
 Block           ::= LBRACE { Statement } RBRACE
 */
 
-std::unique_ptr<ASTNode> Parser::parseBlock()
+AstPtr<ASTNode> Parser::parseBlock()
 {
 
     Token tok = previous();
-    std::vector<std::unique_ptr<ASTNode>> statements;
+    std::vector<AstPtr<ASTNode>> statements;
 
     while (!match(TokenType::RBRACE))
     {
-        statements.push_back(parseStatement());
+        if (peek().type == TokenType::END_OF_FILE)
+        {
+            reportError("Expected '}' before end of file");
+        }
+        if (AstPtr<ASTNode> statement = parseStatementOrRecover())
+        {
+            statements.push_back(statement);
+        }
     }
 
-    return std::make_unique<BlockNode>(
+    return arena.make<BlockNode>(
         std::move(statements),
         tok.line,
         tok.column);
@@ -560,150 +630,97 @@ std::unique_ptr<ASTNode> Parser::parseBlock()
 
 /*
 (* Expressions with full BODMAS + logical operators *)
-Expression      ::= LogicalOr
-
-LogicalOr       ::= LogicalAnd { OR LogicalAnd }
-LogicalAnd      ::= Equality   { AND Equality }
-Equality        ::= Relational { ( EQ | NEQ ) Relational }
-Relational      ::= Additive   { ( LT | GT | LEQ | GEQ ) Additive }
-Additive        ::= Term       { ( PLUS | MINUS ) Term }
-Term            ::= Factor     { ( MULTIPLY | DIVIDE ) Factor }
+Expression      ::= Factor { BinaryOperator Factor }
 Factor          ::= [ NOT | MINUS ] Primary
+
+Binary operators are parsed by precedence climbing. Each entry of the
+table below gives an operator's binding power, associativity and the node
+it builds, so adding an operator is a one-line change here.
 */
 
-std::unique_ptr<ASTNode> Parser::parseExpression()
+namespace
 {
-    return parseLogicalOr();
-}
-
-std::unique_ptr<ASTNode> Parser::parseLogicalOr()
+enum class Associativity
 {
-    auto left = parseLogicalAnd();
-
-    while (match(TokenType::OR))
-    {
-        Token opToken = previous();
-        auto right = parseLogicalAnd();
-
-        left = std::make_unique<LogicalExprNode>(
-            std::move(left),
-            std::move(right),
-            TokenType::OR,
-            opToken.line,
-            opToken.column);
-    }
-
-    return left;
-}
+    LEFT,
+    RIGHT
+};
 
-std::unique_ptr<ASTNode> Parser::parseLogicalAnd()
+struct BinaryOperator
 {
-    auto left = parseEquality();
-
-    while (match(TokenType::AND))
-    {
-        Token opToken = previous();
-        auto right = parseEquality();
-
-        left = std::make_unique<LogicalExprNode>(
-            std::move(left),
-            std::move(right),
-            TokenType::AND,
-            opToken.line,
-            opToken.column);
-    }
-
-    return left;
-}
-
-std::unique_ptr<ASTNode> Parser::parseEquality()
+    TokenType token;
+    int precedence;
+    Associativity associativity;
+    NodeKind node; // LogicalExpr, Comparison or BinaryExpr
+};
+
+const BinaryOperator binaryOperators[] = {
+    {TokenType::OR, 1, Associativity::LEFT, NodeKind::LogicalExpr},
+    {TokenType::AND, 2, Associativity::LEFT, NodeKind::LogicalExpr},
+    {TokenType::EQ, 3, Associativity::LEFT, NodeKind::Comparison},
+    {TokenType::NEQ, 3, Associativity::LEFT, NodeKind::Comparison},
+    {TokenType::LT, 4, Associativity::LEFT, NodeKind::Comparison},
+    {TokenType::GT, 4, Associativity::LEFT, NodeKind::Comparison},
+    {TokenType::LEQ, 4, Associativity::LEFT, NodeKind::Comparison},
+    {TokenType::GEQ, 4, Associativity::LEFT, NodeKind::Comparison},
+    {TokenType::PLUS, 5, Associativity::LEFT, NodeKind::BinaryExpr},
+    {TokenType::MINUS, 5, Associativity::LEFT, NodeKind::BinaryExpr},
+    {TokenType::MULTIPLY, 6, Associativity::LEFT, NodeKind::BinaryExpr},
+    {TokenType::DIVIDE, 6, Associativity::LEFT, NodeKind::BinaryExpr},
+};
+
+const BinaryOperator *findBinaryOperator(TokenType type)
 {
-    auto left = parseRelational();
-
-    while (match(TokenType::EQ) || match(TokenType::NEQ))
+    for (const BinaryOperator &op : binaryOperators)
     {
-        Token opToken = previous();
-
-        auto right = parseRelational();
-        left = std::make_unique<ComparisonNode>(
-            std::move(left),
-            std::move(right),
-            opToken.type,
-            opToken.line,
-            opToken.column);
-    }
-
-    return left;
-}
-
-std::unique_ptr<ASTNode> Parser::parseRelational()
-{
-    auto left = parseAdditive();
-
-    while (match(TokenType::LT) || match(TokenType::GT) || match(TokenType::LEQ) || match(TokenType::GEQ))
-    {
-        Token opToken = previous();
-
-        auto right = parseAdditive();
-        left = std::make_unique<ComparisonNode>(
-            std::move(left),
-            std::move(right),
-            opToken.type,
-            opToken.line,
-            opToken.column);
+        if (op.token == type)
+        {
+            return &op;
+        }
     }
-
-    return left;
+    return nullptr;
 }
+} // namespace
 
-std::unique_ptr<ASTNode> Parser::parseAdditive()
+AstPtr<ASTNode> Parser::parseExpression(int minPrecedence)
 {
-    auto left = parseTerm();
+    auto left = parseFactor();
 
-    while (match(TokenType::PLUS) || match(TokenType::MINUS))
+    while (const BinaryOperator *op = findBinaryOperator(peek().type))
     {
-        Token opToken = previous();
-
-        auto right = parseTerm();
-        left = std::make_unique<BinaryExprNode>(
-            std::move(left),
-            std::move(right),
-            opToken.type,
-            opToken.line,
-            opToken.column);
-    }
-
-    return left;
-}
-
-std::unique_ptr<ASTNode> Parser::parseTerm()
-{
+        if (op->precedence < minPrecedence)
+        {
+            break;
+        }
+        const Token &opToken = advance();
 
-    auto left = parseFactor();
+        int nextMinPrecedence = op->associativity == Associativity::LEFT ? op->precedence + 1 : op->precedence;
+        auto right = parseExpression(nextMinPrecedence);
 
-    while (match(TokenType::MULTIPLY) || match(TokenType::DIVIDE))
-    {
-        Token opToken = previous();
-        // auto right = parseTerm();
-        auto right = parseFactor();
-        left = std::make_unique<BinaryExprNode>(
-            std::move(left),
-            std::move(right),
-            opToken.type,
-            opToken.line,
-            opToken.column);
+        switch (op->node)
+        {
+        case NodeKind::LogicalExpr:
+            left = arena.make<LogicalExprNode>(std::move(left), std::move(right), opToken.type, opToken.line, opToken.column);
+            break;
+        case NodeKind::Comparison:
+            left = arena.make<ComparisonNode>(std::move(left), std::move(right), opToken.type, opToken.line, opToken.column);
+            break;
+        default:
+            left = arena.make<BinaryExprNode>(std::move(left), std::move(right), opToken.type, opToken.line, opToken.column);
+            break;
+        }
     }
 
     return left;
 }
 
-std::unique_ptr<ASTNode> Parser::parseFactor()
+AstPtr<ASTNode> Parser::parseFactor()
 {
     if (match(TokenType::NOT) || match(TokenType::MINUS))
     {
         Token opToken = previous();
         auto operand = parseFactor();
-        return std::make_unique<UnaryExprNode>(
+        return arena.make<UnaryExprNode>(
             std::move(operand),
             opToken.type,
             opToken.line,
@@ -714,28 +731,41 @@ std::unique_ptr<ASTNode> Parser::parseFactor()
 }
 
 /*
-Primary         ::= IDENTIFIER
+Primary         ::= ( IDENTIFIER | CallExpression ) { LBRACKET Expression RBRACKET }
               | NUMBER_LITERAL
               | STRING_LITERAL
               | LPAREN Expression RPAREN
-              | CallExpression
+              | ArrayAlloc
 
 CallExpression  ::= IDENTIFIER LPAREN [ ArgumentList ] RPAREN
 
 ArgumentList    ::= Expression { COMMA Expression }
 */
 
-std::unique_ptr<ASTNode> Parser::parsePrimary()
+AstPtr<ASTNode> Parser::parsePrimary()
 {
     if (match(TokenType::IDENTIFIER))
     {
-
+        AstPtr<ASTNode> primary;
         if (peek().type == TokenType::LPAREN)
         {
             Token functionToken = previous();
-            return parseCallExpression(functionToken);
+            primary = parseCallExpression(functionToken);
+        }
+        else
+        {
+            primary = parseIdentifier();
         }
-        return parseIdentifier();
+        while (match(TokenType::LBRACKET))
+        {
+            primary = parseIndex(std::move(primary));
+        }
+        return primary;
+    }
+
+    if (match(TokenType::NUMBER))
+    {
+        return parseArrayAlloc();
     }
 
     if (match(TokenType::NUMBER_LITERAL))
@@ -763,7 +793,48 @@ std::unique_ptr<ASTNode> Parser::parsePrimary()
     return NULL;
 }
 
-std::unique_ptr<ASTNode> Parser::parseCallExpression(Token &functionToken)
+// `array` followed by '[': the rest of an element access.
+AstPtr<ASTNode> Parser::parseIndex(AstPtr<ASTNode> array)
+{
+    Token bracketToken = previous();
+    auto index = parseExpression();
+    if (!match(TokenType::RBRACKET))
+    {
+        reportError("Expected ']' after array index");
+        return NULL;
+    }
+    return arena.make<IndexNode>(
+        std::move(array),
+        std::move(index),
+        bracketToken.line,
+        bracketToken.column);
+}
+
+/*
+ArrayAlloc      ::= NUMBER LBRACKET Expression RBRACKET
+*/
+
+AstPtr<ASTNode> Parser::parseArrayAlloc()
+{
+    Token typeToken = previous();
+    if (!match(TokenType::LBRACKET))
+    {
+        reportError("Expected '[' and a size after 'number' in an expression");
+        return NULL;
+    }
+    auto size = parseExpression();
+    if (!match(TokenType::RBRACKET))
+    {
+        reportError("Expected ']' after array size");
+        return NULL;
+    }
+    return arena.make<ArrayAllocNode>(
+        std::move(size),
+        typeToken.line,
+        typeToken.column);
+}
+
+AstPtr<ASTNode> Parser::parseCallExpression(Token &functionToken)
 {
 
     if (functionToken.type != TokenType::IDENTIFIER)
@@ -778,7 +849,7 @@ std::unique_ptr<ASTNode> Parser::parseCallExpression(Token &functionToken)
         return NULL;
     }
 
-    std::vector<std::unique_ptr<ASTNode>> argumentList;
+    std::vector<AstPtr<ASTNode>> argumentList;
 
     if (peek().type != TokenType::RPAREN)
     {
@@ -791,16 +862,16 @@ std::unique_ptr<ASTNode> Parser::parseCallExpression(Token &functionToken)
         return NULL;
     }
 
-    return std::make_unique<CallExprNode>(
-        functionToken.value,
+    return arena.make<CallExprNode>(
+        functionToken.symbol,
         std::move(argumentList),
         functionToken.line,
         functionToken.column);
 }
 
-std::vector<std::unique_ptr<ASTNode>> Parser::parseArgumentList()
+std::vector<AstPtr<ASTNode>> Parser::parseArgumentList()
 {
-    std::vector<std::unique_ptr<ASTNode>> argumentList;
+    std::vector<AstPtr<ASTNode>> argumentList;
     auto argument1 = parseExpression();
 
     argumentList.push_back(std::move(argument1));
@@ -821,7 +892,7 @@ NUMBER          ::= 'number'
 STRING          ::= 'string'
 */
 
-std::unique_ptr<VarDeclareNode> Parser::parseNumber()
+AstPtr<VarDeclareNode> Parser::parseNumber()
 {
     Token typeToken = previous();
 
@@ -833,19 +904,19 @@ std::unique_ptr<VarDeclareNode> Parser::parseNumber()
 
     Token nameToken = previous();
 
-    std::unique_ptr<ASTNode> initializer = NULL;
+    AstPtr<ASTNode> initializer = NULL;
     if (match(TokenType::EQ))
     {
         initializer = parseExpression();
     }
 
-    return std::make_unique<VarDeclareNode>(
+    return arena.make<VarDeclareNode>(
         typeToken.type,
         nameToken,
         std::move(initializer));
 }
 
-std::unique_ptr<VarDeclareNode> Parser::parseString()
+AstPtr<VarDeclareNode> Parser::parseString()
 {
     Token typeToken = previous();
 
@@ -857,13 +928,13 @@ std::unique_ptr<VarDeclareNode> Parser::parseString()
 
     Token nameToken = previous();
 
-    std::unique_ptr<ASTNode> initializer = NULL;
+    AstPtr<ASTNode> initializer = NULL;
     if (match(TokenType::EQ))
     {
         initializer = parseExpression();
     }
 
-    return std::make_unique<VarDeclareNode>(
+    return arena.make<VarDeclareNode>(
         typeToken.type,
         nameToken,
         std::move(initializer));
@@ -877,29 +948,29 @@ STRING_LITERAL  ::= '"' { Character } '"'
 
 */
 
-std::unique_ptr<ASTNode> Parser::parseIdentifier()
+AstPtr<ASTNode> Parser::parseIdentifier()
 {
     Token idTok = previous();
-    return std::make_unique<VariableNode>(
-        idTok.value,
+    return arena.make<VariableNode>(
+        idTok.symbol,
         idTok.line,
         idTok.column);
 }
 
-std::unique_ptr<ASTNode> Parser::parseNumberLiteral()
+AstPtr<ASTNode> Parser::parseNumberLiteral()
 {
     Token idTok = previous();
-    return std::make_unique<NumberLiteralNode>(
+    return arena.make<NumberLiteralNode>(
         idTok.value,
         idTok.line,
         idTok.column);
 }
 
-std::unique_ptr<ASTNode> Parser::parseStringLiteral()
+AstPtr<ASTNode> Parser::parseStringLiteral()
 {
     Token idTok = previous();
-    return std::make_unique<StringLiteralNode>(
-        idTok.value,
+    return arena.make<StringLiteralNode>(
+        idTok.symbol,
         idTok.line,
         idTok.column);
 }
@@ -910,6 +981,8 @@ LPAREN          ::= '('
 RPAREN          ::= ')'
 LBRACE          ::= '{'
 RBRACE          ::= '}'
+LBRACKET        ::= '['
+RBRACKET        ::= ']'
 COMMA           ::= ','
 SEMICOLON       ::= ';'
 
@@ -940,14 +1013,23 @@ PRINT           ::= 'print'
 */
 
 // Program ::= { Statement } END_OF_FILE
-std::unique_ptr<BlockNode> Parser::parseProgram()
+ParseResult Parser::parseProgram()
 {
-    std::vector<std::unique_ptr<ASTNode>> statements;
+    errors.clear();
+    std::vector<AstPtr<ASTNode>> statements;
     while (!match(TokenType::END_OF_FILE))
     {
-        statements.push_back(parseStatement());
+        if (AstPtr<ASTNode> statement = parseStatementOrRecover())
+        {
+            statements.push_back(statement);
+        }
+        else if (peek().type == TokenType::RBRACE)
+        {
+            advance(); // a stray '}' at top level cannot close anything
+        }
     }
-    return std::make_unique<BlockNode>(std::move(statements), 0, 0); // because the program simply starts from first line and first column
+    AstPtr<BlockNode> root = arena.make<BlockNode>(std::move(statements), 0, 0); // because the program simply starts from first line and first column
+    return {root, std::move(errors)};
 }
 
-Parser::Parser(std::vector<Token> tokens) : tokens(std::move(tokens)) {}
+Parser::Parser(std::vector<Token> tokens, AstArena &arena) : tokens(std::move(tokens)), arena(arena) {}
@@ -4,50 +4,73 @@
 #include<../Parser/ast.hpp>
 #include<vector>
 #include <memory>
+#include <string>
 
+struct ParseError {
+    int line, col;
+    TokenType token; // the token the parser stopped at
+    std::string message;
+};
+
+struct ParseResult {
+    AstPtr<BlockNode> root;          // always set; erroneous statements are left out
+    std::vector<ParseError> errors;  // in source order
+
+    bool ok() const { return errors.empty(); }
+};
+
+std::ostream &operator<<(std::ostream &os, const ParseError &error);
 
 class Parser {
 private:
+    // Thrown by reportError to unwind to the nearest statement boundary.
+    struct SyntaxError {};
+
+
     std::vector<Token> tokens;
+    AstArena &arena;
     size_t current = 0;
-    Token peek();
-    Token advance();
-    Token previous();
-    std::unique_ptr<ASTNode> parseStatement();
-    std::unique_ptr<ASTNode> parseReturnStatement();
-    std::unique_ptr<ASTNode> parseDeclaration();
-    std::vector<std::unique_ptr<VarDeclareNode>> parseVarList(TokenType variableType);
-    std::unique_ptr<ASTNode> parseAssignment();
-    std::unique_ptr<ASTNode> parseIfStatement();
-    std::unique_ptr<ASTNode> parseWhileLoop();
-    std::vector<std::pair<std::string, std::string>> parseParameterList();
-    std::unique_ptr<ASTNode> parseFunctionDecl();
-    std::unique_ptr<ASTNode> parsePrintStatement();
-    std::unique_ptr<ASTNode> parseBlock();
-    std::unique_ptr<ASTNode> parseExpression();
-    std::unique_ptr<ASTNode> parseLogicalOr();
-    std::unique_ptr<ASTNode> parseLogicalAnd();
-    std::unique_ptr<ASTNode> parseEquality();
-    std::unique_ptr<ASTNode> parseRelational();
-    std::unique_ptr<ASTNode> parseAdditive();
-    std::unique_ptr<ASTNode> parseTerm();
-    std::unique_ptr<ASTNode> parseFactor();
-    std::unique_ptr<ASTNode> parsePrimary();
-    std::unique_ptr<ASTNode> parseCallExpression(Token &functionToken);
-    std::vector<std::unique_ptr<ASTNode>> parseArgumentList();
-    std::unique_ptr<VarDeclareNode> parseNumber();
-    std::unique_ptr<VarDeclareNode> parseString();
-    std::unique_ptr<ASTNode> parseIdentifier();
-    std::unique_ptr<ASTNode> parseNumberLiteral();
-    std::unique_ptr<ASTNode> parseStringLiteral();
-
-    void reportError(const std::string& message);
+    const Token &peek() const;
+    const Token &advance();
+    const Token &previous() const;
+    AstPtr<ASTNode> parseStatement();
+    AstPtr<ASTNode> parseReturnStatement();
+    AstPtr<ASTNode> parseDeclaration();
+    std::vector<AstPtr<VarDeclareNode>> parseVarList(TokenType variableType);
+    AstPtr<ASTNode> parseAssignment();
+    AstPtr<ASTNode> parseIfStatement();
+    AstPtr<ASTNode> parseWhileLoop();
+    std::vector<std::pair<std::string, Symbol>> parseParameterList();
+    AstPtr<ASTNode> parseFunctionDecl();
+    AstPtr<ASTNode> parsePrintStatement();
+    AstPtr<ASTNode> parseBlock();
+    AstPtr<ASTNode> parseExpression(int minPrecedence = 1);
+    AstPtr<ASTNode> parseFactor();
+    AstPtr<ASTNode> parsePrimary();
+    AstPtr<ASTNode> parseCallExpression(Token &functionToken);
+    AstPtr<ASTNode> parseIndex(AstPtr<ASTNode> array);
+    AstPtr<ASTNode> parseArrayAlloc();
+    std::vector<AstPtr<ASTNode>> parseArgumentList();
+    AstPtr<VarDeclareNode> parseNumber();
+    AstPtr<VarDeclareNode> parseString();
+    AstPtr<ASTNode> parseIdentifier();
+    AstPtr<ASTNode> parseNumberLiteral();
+    AstPtr<ASTNode> parseStringLiteral();
+
+    std::vector<ParseError> errors;
+
+    [[noreturn]] void reportError(const std::string& message);
+    void synchronize();
+    AstPtr<ASTNode> parseStatementOrRecover();
     bool match(TokenType type);
 
 public:
-    std::unique_ptr<BlockNode> parseProgram();
+    // Never exits the process: every syntax error is collected and parsing
+    // resumes at the next ';' or '}'.
+    ParseResult parseProgram();
 
-    Parser(std::vector<Token> tokens);
+    // Nodes are allocated in `arena` and stay valid for as long as it lives.
+    Parser(std::vector<Token> tokens, AstArena &arena);
 
 };
 
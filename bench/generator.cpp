@@ -0,0 +1,176 @@
+#include "generator.hpp"
+#include <sstream>
+
+namespace {
+
+// xorshift32: tiny, and identical on every platform, unlike std::rand.
+class Random {
+public:
+    explicit Random(uint32_t seed) : state(seed ? seed : 1) {}
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    int below(int bound) { return static_cast<int>(next() % static_cast<uint32_t>(bound)); }
+
+private:
+    uint32_t state;
+};
+
+// A random arithmetic expression over `vars` with `depth` levels of nesting.
+// Products and quotients take a small literal on the right, which keeps
+// divisors non-zero and values far from overflow.
+void writeExpression(std::ostream &out, Random &random, int depth, const std::vector<std::string> &vars) {
+    if (depth == 0) {
+        if (random.below(3) == 0) {
+            out << random.below(100);
+        } else {
+            out << vars[random.below(static_cast<int>(vars.size()))];
+        }
+        return;
+    }
+    static const char *const operators[] = {" + ", " - ", " * ", " / "};
+    int op = random.below(4);
+    out << '(';
+    writeExpression(out, random, depth - 1, vars);
+    out << operators[op];
+    if (op >= 2) {
+        out << 1 + random.below(9);
+    } else {
+        writeExpression(out, random, depth - 1, vars);
+    }
+    out << ')';
+}
+
+std::string deepExpressions(int size, Random &random) {
+    std::ostringstream out;
+    std::vector<std::string> vars = {"a", "b", "c", "d"};
+    out << "func main() {\n";
+    out << "    number a = 3;\n    number b = 5;\n    number c = 7;\n    number d = 11;\n";
+    out << "    number acc = 0;\n";
+    for (int i = 0; i < size; ++i) {
+        out << "    acc = ";
+        writeExpression(out, random, 6, vars);
+        out << ";\n";
+    }
+    out << "    print(acc);\n}\n";
+    return out.str();
+}
+
+std::string manyFunctions(int size, Random &random) {
+    std::ostringstream out;
+    for (int i = 0; i < size; ++i) {
+        out << "func f" << i << "(number x, number y) {\n";
+        out << "    number t = " << random.below(50) << ";\n";
+        out << "    if (x > y) {\n        t = t + x - y;\n    } else {\n        t = t + y - x;\n    }\n";
+        if (i > 0) {
+            // Call a few earlier functions so the parallel driver sees real
+            // dependency chains, not one flat wave.
+            int callee = random.below(i);
+            out << "    t = t + f" << callee << "(x, t);\n";
+        }
+        out << "    return t;\n}\n\n";
+    }
+    out << "func main() {\n    number total = 0;\n";
+    for (int i = 0; i < size; i += 1 + size / 50) {
+        out << "    total = total + f" << i << "(" << random.below(10) << ", " << random.below(10) << ");\n";
+    }
+    out << "    print(total);\n}\n";
+    return out.str();
+}
+
+std::string longLoops(int size, Random &) {
+    std::ostringstream out;
+    out << "func main() {\n";
+    out << "    number i = 0;\n    number sum = 0;\n";
+    out << "    while (i < " << size << ") {\n";
+    out << "        number j = 0;\n";
+    out << "        while (j < 100) {\n";
+    out << "            sum = sum + i * j - (sum / 7);\n";
+    out << "            if (sum > 1000000) {\n                sum = sum - 1000000;\n            }\n";
+    out << "            j = j + 1;\n";
+    out << "        }\n";
+    out << "        i = i + 1;\n";
+    out << "    }\n";
+    out << "    print(sum);\n}\n";
+    return out.str();
+}
+
+// Recursive calls may only appear as statements (their return type is not
+// known inside their own body), so the tree walk counts into a printout
+// rather than returning values.
+std::string recursion(int size, Random &) {
+    std::ostringstream out;
+    out << "func walk(number depth) {\n";
+    out << "    if (depth > 0) {\n";
+    out << "        walk(depth - 1);\n";
+    out << "        walk(depth - 1);\n";
+    out << "    }\n";
+    out << "}\n\n";
+    out << "func main() {\n";
+    out << "    walk(" << size << ");\n";
+    out << "    print(\"done\");\n}\n";
+    return out.str();
+}
+
+std::string strings(int size, Random &random) {
+    static const char *const words[] = {"alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta"};
+    std::ostringstream out;
+    out << "func label(string prefix, number n) {\n";
+    out << "    if (n > 50) {\n        return prefix + \"-high\";\n    }\n";
+    out << "    return prefix + \"-low\";\n}\n\n";
+    out << "func main() {\n";
+    out << "    number i = 0;\n    number matches = 0;\n";
+    out << "    while (i < " << size << ") {\n";
+    out << "        string line = \"\";\n";
+    for (int w = 0; w < 6; ++w) {
+        out << "        line = line + \"" << words[random.below(8)] << " \";\n";
+    }
+    out << "        string tag = label(\"" << words[random.below(8)] << "\", i - (i / 100) * 100);\n";
+    out << "        if (tag == \"" << words[random.below(8)] << "-high\") {\n";
+    out << "            matches = matches + 1;\n";
+    out << "        }\n";
+    out << "        if (line != tag) {\n            matches = matches + 1;\n        }\n";
+    out << "        i = i + 1;\n";
+    out << "    }\n";
+    out << "    print(matches);\n}\n";
+    return out.str();
+}
+
+} // namespace
+
+const std::vector<WorkloadInfo> &allWorkloads() {
+    static const std::vector<WorkloadInfo> workloads = {
+        {Workload::DEEP_EXPRESSIONS, "deep_expressions", 2000},
+        {Workload::MANY_FUNCTIONS, "many_functions", 2000},
+        {Workload::LONG_LOOPS, "long_loops", 200},
+        {Workload::RECURSION, "recursion", 13},
+        {Workload::STRINGS, "strings", 5000},
+    };
+    return workloads;
+}
+
+const WorkloadInfo *findWorkload(const std::string &name) {
+    for (const WorkloadInfo &info : allWorkloads()) {
+        if (name == info.name) {
+            return &info;
+        }
+    }
+    return nullptr;
+}
+
+std::string generateProgram(Workload kind, int size, uint32_t seed) {
+    Random random(seed);
+    switch (kind) {
+        case Workload::DEEP_EXPRESSIONS: return deepExpressions(size, random);
+        case Workload::MANY_FUNCTIONS: return manyFunctions(size, random);
+        case Workload::LONG_LOOPS: return longLoops(size, random);
+        case Workload::RECURSION: return recursion(size, random);
+        case Workload::STRINGS: return strings(size, random);
+    }
+    return {};
+}
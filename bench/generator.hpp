@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+    Deterministic generator of large SIMPL programs for the benchmark
+    harness. The same (workload, size, seed) always produces the same text,
+    so timings from different builds are comparable. `size` scales the
+    program roughly linearly in source length or in run time, depending on
+    the workload.
+*/
+enum class Workload {
+    DEEP_EXPRESSIONS, // long, deeply parenthesised arithmetic: lexer and parser
+    MANY_FUNCTIONS,   // thousands of small functions calling each other: analysis and lowering
+    LONG_LOOPS,       // nested counting loops: interpreter dispatch
+    RECURSION,        // a binary call tree: call and return overhead
+    STRINGS           // concatenation and comparison in loops: string values
+};
+
+struct WorkloadInfo {
+    Workload kind;
+    const char *name;
+    int defaultSize;
+};
+
+const std::vector<WorkloadInfo> &allWorkloads();
+
+// Returns nullptr for an unknown name.
+const WorkloadInfo *findWorkload(const std::string &name);
+
+std::string generateProgram(Workload kind, int size, uint32_t seed = 1);
@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "generator.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "parallel_compiler.hpp"
+#include "interpreter.hpp"
+#include "output_sink.hpp"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+/*
+    Benchmark harness for the whole pipeline. Each workload from
+    generator.hpp is generated once, then lexed, parsed, compiled and run
+    `iterations` times; the report gives the median and tail of every phase
+    together with throughput figures and the process's peak RSS.
+
+    A baseline is a plain text file of "workload phase median_ms" lines.
+    --save-baseline writes one, --baseline compares against one and exits
+    with status 2 if any phase got slower than the tolerance allows.
+*/
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char *const PHASES[] = {"lex", "parse", "compile", "execute", "total"};
+constexpr size_t PHASE_COUNT = sizeof(PHASES) / sizeof(PHASES[0]);
+
+struct Options {
+    int iterations = 5;
+    double scale = 1.0;
+    uint32_t seed = 1;
+    unsigned workers = 0;
+    std::vector<std::string> only;
+    std::string baseline;
+    std::string saveBaseline;
+    double tolerance = 10.0; // percent
+};
+
+struct Result {
+    std::string workload;
+    size_t sourceBytes = 0;
+    size_t tokens = 0;
+    size_t nodes = 0;
+    size_t irInstructions = 0;
+    uint64_t executed = 0;
+    std::vector<double> samples[PHASE_COUNT]; // milliseconds per iteration
+};
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Nearest-rank percentile of an unsorted sample.
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(p / 100.0 * values.size() + 0.999999);
+    return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+}
+
+long peakRSSKilobytes() {
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return -1;
+}
+
+// One lex/parse/compile/execute round. Returns false (after printing the
+// reason) if the generated program does not compile.
+bool runOnce(const std::string &source, const Options &options, Result &result, bool countInstructions) {
+    Clock::time_point start = Clock::now();
+    Clock::time_point phaseStart = start;
+
+    Lexer lexer(source);
+    std::vector<Token> tokens;
+    Token token;
+    do {
+        token = lexer.getNextToken();
+        tokens.push_back(token);
+    } while (token.type != TokenType::END_OF_FILE);
+    result.samples[0].push_back(millisecondsSince(phaseStart));
+
+    phaseStart = Clock::now();
+    AstArena arena;
+    size_t tokenCount = tokens.size();
+    Parser parser(std::move(tokens), arena);
+    ParseResult parsed = parser.parseProgram();
+    result.samples[1].push_back(millisecondsSince(phaseStart));
+    if (!parsed.ok()) {
+        std::cerr << result.workload << ": generated program failed to parse\n";
+        for (const ParseError &error : parsed.errors) {
+            std::cerr << error;
+        }
+        return false;
+    }
+
+    phaseStart = Clock::now();
+    ParallelCompiler compiler(options.workers);
+    try {
+        compiler.compile(parsed.root.get());
+    } catch (const std::runtime_error &e) {
+        std::cerr << result.workload << ": generated program failed to compile: " << e.what() << "\n";
+        return false;
+    }
+    result.samples[2].push_back(millisecondsSince(phaseStart));
+
+    phaseStart = Clock::now();
+    MemoryOutputTarget captured;
+    OutputSink output(captured, FlushPolicy::ON_EXIT);
+    TACInterpreter interpreter(compiler.getIR(), &output);
+    ExecutionProfile profile;
+    if (countInstructions) {
+        interpreter.set_profile(&profile);
+    }
+    interpreter.execute();
+    result.samples[3].push_back(millisecondsSince(phaseStart));
+    result.samples[4].push_back(millisecondsSince(start));
+
+    result.tokens = tokenCount;
+    result.nodes = arena.nodeCount();
+    result.irInstructions = compiler.getIR().instructions.size();
+    if (countInstructions) {
+        result.executed = profile.instructions;
+    }
+    return true;
+}
+
+std::string formatRate(double count, double milliseconds) {
+    if (milliseconds <= 0) return "-";
+    double perSecond = count / (milliseconds / 1000.0);
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    if (perSecond >= 1e6) out << perSecond / 1e6 << " M/s";
+    else if (perSecond >= 1e3) out << perSecond / 1e3 << " k/s";
+    else out << perSecond << " /s";
+    return out.str();
+}
+
+void printResult(const Result &result, int iterations) {
+    std::cout << "\n== " << result.workload << " (" << result.sourceBytes << " bytes, " << result.tokens << " tokens, "
+              << result.nodes << " nodes, " << result.irInstructions << " IR instructions, " << result.executed
+              << " executed; " << iterations << " runs)\n";
+    std::cout << std::left << std::setw(10) << "phase" << std::right << std::setw(12) << "median ms" << std::setw(12)
+              << "p90 ms" << std::setw(12) << "p99 ms" << std::setw(12) << "min ms" << "   throughput\n";
+    std::cout << std::fixed << std::setprecision(3);
+    for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+        const std::vector<double> &samples = result.samples[phase];
+        double median = percentile(samples, 50);
+        std::string rate;
+        if (phase == 0) rate = formatRate(result.tokens, median) + " tokens";
+        else if (phase == 1) rate = formatRate(result.nodes, median) + " nodes";
+        else if (phase == 2) rate = formatRate(result.irInstructions, median) + " IR instructions";
+        else if (phase == 3) rate = formatRate(static_cast<double>(result.executed), median) + " instructions";
+        std::cout << std::left << std::setw(10) << PHASES[phase] << std::right << std::setw(12) << median << std::setw(12)
+                  << percentile(samples, 90) << std::setw(12) << percentile(samples, 99) << std::setw(12)
+                  << *std::min_element(samples.begin(), samples.end()) << "   " << rate << "\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+std::map<std::pair<std::string, std::string>, double> readBaseline(const std::string &path) {
+    std::map<std::pair<std::string, std::string>, double> baseline;
+    std::ifstream in(path);
+    std::string workload, phase;
+    double median;
+    while (in >> workload >> phase >> median) {
+        baseline[{workload, phase}] = median;
+    }
+    return baseline;
+}
+
+bool parseArguments(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char * {
+            if (i + 1 == argc) {
+                std::cerr << arg << " needs a value\n";
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+        if (arg == "--iterations") {
+            options.iterations = std::max(1, std::atoi(value()));
+        } else if (arg == "--scale") {
+            options.scale = std::atof(value());
+        } else if (arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::strtoul(value(), nullptr, 10));
+        } else if (arg == "--workers") {
+            options.workers = static_cast<unsigned>(std::atoi(value()));
+        } else if (arg == "--only") {
+            options.only.push_back(value());
+        } else if (arg == "--baseline") {
+            options.baseline = value();
+        } else if (arg == "--save-baseline") {
+            options.saveBaseline = value();
+        } else if (arg == "--tolerance") {
+            options.tolerance = std::atof(value());
+        } else if (arg == "--emit") {
+            // --emit <workload> <file>: write one generated program and stop.
+            const WorkloadInfo *info = findWorkload(value());
+            std::string path = value();
+            if (!info) {
+                std::cerr << "Unknown workload\n";
+                std::exit(1);
+            }
+            std::ofstream out(path);
+            out << generateProgram(info->kind, static_cast<int>(info->defaultSize * options.scale), options.seed);
+            out.close(); // std::exit skips destructors
+            std::exit(out ? 0 : 1);
+        } else {
+            std::cerr << "Usage: simpl_bench [--iterations n] [--scale x] [--seed n] [--workers n]\n"
+                      << "                   [--only workload]... [--baseline file] [--save-baseline file]\n"
+                      << "                   [--tolerance percent] [--emit workload file]\n"
+                      << "Workloads:";
+            for (const WorkloadInfo &info : allWorkloads()) {
+                std::cerr << " " << info.name;
+            }
+            std::cerr << "\n";
+            return false;
+        }
+    }
+    for (const std::string &name : options.only) {
+        if (!findWorkload(name)) {
+            std::cerr << "Unknown workload '" << name << "'\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for (const WorkloadInfo &info : allWorkloads()) {
+        if (!options.only.empty() && std::find(options.only.begin(), options.only.end(), info.name) == options.only.end()) {
+            continue;
+        }
+        int size = std::max(1, static_cast<int>(info.defaultSize * options.scale));
+        // Keep the call tree's size linear in --scale.
+        if (info.kind == Workload::RECURSION && options.scale != 1.0) {
+            size = std::max(1, info.defaultSize + static_cast<int>(std::log2(options.scale)));
+        }
+        std::string source = generateProgram(info.kind, size, options.seed);
+
+        Result result;
+        result.workload = info.name;
+        result.sourceBytes = source.size();
+
+        // One untimed warm-up round that also counts executed instructions.
+        if (!runOnce(source, options, result, true)) {
+            return 1;
+        }
+        for (auto &samples : result.samples) {
+            samples.clear();
+        }
+        for (int i = 0; i < options.iterations; ++i) {
+            runOnce(source, options, result, false);
+        }
+        printResult(result, options.iterations);
+        results.push_back(std::move(result));
+    }
+
+    std::cout << "\npeak RSS: " << peakRSSKilobytes() << " KiB\n";
+
+    if (!options.saveBaseline.empty()) {
+        std::ofstream out(options.saveBaseline);
+        for (const Result &result : results) {
+            for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+                out << result.workload << " " << PHASES[phase] << " " << percentile(result.samples[phase], 50) << "\n";
+            }
+        }
+        std::cout << "baseline written to " << options.saveBaseline << "\n";
+    }
+
+    int status = 0;
+    if (!options.baseline.empty()) {
+        auto baseline = readBaseline(options.baseline);
+        std::cout << "\n== compared with " << options.baseline << " (tolerance " << options.tolerance << "%)\n";
+        std::cout << std::fixed << std::setprecision(3);
+        for (const Result &result : results) {
+            for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+                auto found = baseline.find({result.workload, PHASES[phase]});
+                if (found == baseline.end() || found->second <= 0) continue;
+                double now = percentile(result.samples[phase], 50);
+                double change = (now - found->second) / found->second * 100.0;
+                // Sub-0.1 ms differences are timer noise, whatever the percentage.
+                bool regressed = change > options.tolerance && now - found->second > 0.1;
+                std::cout << std::left << std::setw(18) << result.workload << std::setw(10) << PHASES[phase] << std::right
+                          << std::setw(12) << found->second << " -> " << std::setw(10) << now << std::showpos
+                          << std::setw(10) << std::setprecision(1) << change << "%" << std::noshowpos << std::setprecision(3)
+                          << (regressed ? "  REGRESSION" : "") << "\n";
+                if (regressed) {
+                    status = 2;
+                }
+            }
+        }
+    }
+    return status;
+}
@@ -4,27 +4,428 @@
 #include "Lexer/lexer.hpp"
 #include "Parser/parser.hpp" 
 #include "Parser/astPrinter.hpp"
-#include "Semantic_analyzer/include/semantic_analyzer.hpp"
+#include "semantic_analyzer/include/semantic_analyzer.hpp"
 #include "IR/ir_generator.hpp"  
+#include "Driver/parallel_compiler.hpp"
 #include "IR/ir.hpp"   
 #include "Interpreter/interpreter.hpp"   
+#include "IR/ir_cache.hpp"
+#include "Driver/instrumentation.hpp"
+#include "Driver/runner.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <optional>
 
-int main(int argc, char **argv) {
-    if(argc == 1) {
+struct Options {
+    std::string filename;
+    bool dumpTokens = false;
+    bool dumpAST = false;
+    bool dumpSymbols = false;
+    bool dumpIR = false;
+    bool timePhases = false;
+    bool stats = false;
+    std::string statsJSON;     // file for the JSON report, "-" for stdout
+    std::string profileFile;   // folded stacks from the sampling profiler
+    uint64_t profileInterval = 997; // prime, so samples do not lock onto a loop's period
+    std::string cacheDir;
+    std::string outputFile;    // program output goes to stdout when empty
+    std::string flushPolicy;   // "exit", "size" or "line"; empty picks by target
+    ExecutionLimits limits;
+    size_t memoEntries = 0;    // results of pure functions to cache; 0 disables
+    unsigned threads = 0;      // for parallelSum and the like; 0 picks one per core
+
+    bool dumpsFrontEnd() const { return dumpTokens || dumpAST || dumpSymbols; }
+    bool dumpsAnything() const { return dumpsFrontEnd() || dumpIR; }
+};
+
+static void printUsage(std::ostream& out) {
+    out << "Usage: simpl_lexer [run] [options] <file.simpl>\n"
+        << "\n"
+        << "Runs the program and prints only its output unless asked for more.\n"
+        << "\n"
+        << "Options:\n"
+        << "  --dump-tokens      print the token stream\n"
+        << "  --dump-ast         print the syntax tree\n"
+        << "  --dump-symbols     print every symbol table\n"
+        << "  --dump-ir          print the generated IR\n"
+        << "  --dump-all         all of the above\n"
+        << "  --time-phases      report how long each phase took on stderr\n"
+        << "  --stats            print phase, opcode and function statistics on stderr\n"
+        << "  --stats-json <file> write the same statistics as JSON (\"-\" for stdout)\n"
+        << "  --cache-dir <dir>  reuse compiled IR kept in <dir> (default: $SIMPL_CACHE_DIR)\n"
+        << "  --profile <file>   sample the program's call stacks into <file> as folded stacks\n"
+        << "  --profile-interval <n>  instructions between samples (default: 997)\n"
+        << "  --output <file>    write the program's output to <file>\n"
+        << "  --flush <policy>   when to flush program output: exit, size or line\n"
+        << "                     (default: line on a terminal, size otherwise)\n"
+        << "  --max-instructions <n>  stop after about n executed instructions\n"
+        << "  --max-depth <n>    stop when calls nest deeper than n frames\n"
+        << "  --max-memory <bytes>  stop when frames, strings and arrays hold more\n"
+        << "  --timeout <ms>     stop after this many milliseconds of execution\n"
+        << "  --memoize <n>      cache up to n results of pure number functions\n"
+        << "  --threads <n>      threads for parallelSum, parallelCount and parallelMax\n"
+        << "                     (default: one per core)\n"
+        << "  -h, --help         show this message\n"
+        << "\n"
+        << "       simpl_lexer batch [--jobs n] [--repeat n] [--slice n] [limits] <file.simpl>...\n"
+        << "\n"
+        << "Compiles each file once and runs all of them (each `repeat` times) on a\n"
+        << "pool of `jobs` threads, printing every run's output in order. With\n"
+        << "--slice, the runs instead take turns on one thread, n instructions at a\n"
+        << "time. The limit options above apply to every run.\n";
+}
+
+static bool isLimitOption(const std::string& arg) {
+    return arg == "--max-instructions" || arg == "--max-depth" || arg == "--max-memory" || arg == "--timeout";
+}
+
+// Sets the limit named by `arg` from `value`, a positive integer.
+static bool parseLimit(const std::string& arg, const char* value, ExecutionLimits& limits) {
+    char* end = nullptr;
+    unsigned long long number = value ? std::strtoull(value, &end, 10) : 0;
+    if (!value || *value == '\0' || *value == '-' || *end != '\0' || number == 0) {
+        std::cerr << arg << " needs a positive number\n";
+        return false;
+    }
+    if (arg == "--max-instructions") {
+        limits.max_instructions = number;
+    } else if (arg == "--max-depth") {
+        limits.max_call_depth = static_cast<size_t>(number);
+    } else if (arg == "--max-memory") {
+        limits.max_memory_bytes = static_cast<size_t>(number);
+    } else {
+        limits.timeout = std::chrono::milliseconds(number);
+    }
+    return true;
+}
+
+// Returns false after reporting the problem when the arguments are unusable.
+static bool parseArguments(int argc, char** argv, Options& options) {
+    if (const char* cacheDir = std::getenv("SIMPL_CACHE_DIR")) {
+        options.cacheDir = cacheDir;
+    }
+
+    int first = 1;
+    if (argc > 1 && std::string(argv[1]) == "run") {
+        first = 2;
+    }
+
+    for (int i = first; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--dump-tokens") {
+            options.dumpTokens = true;
+        } else if (arg == "--dump-ast") {
+            options.dumpAST = true;
+        } else if (arg == "--dump-symbols") {
+            options.dumpSymbols = true;
+        } else if (arg == "--dump-ir") {
+            options.dumpIR = true;
+        } else if (arg == "--dump-all") {
+            options.dumpTokens = options.dumpAST = options.dumpSymbols = options.dumpIR = true;
+        } else if (arg == "--time-phases") {
+            options.timePhases = true;
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (arg == "--stats-json") {
+            if (i + 1 == argc) {
+                std::cerr << "--stats-json needs a file\n";
+                return false;
+            }
+            options.statsJSON = argv[++i];
+        } else if (arg == "--cache-dir") {
+            if (i + 1 == argc) {
+                std::cerr << "--cache-dir needs a directory\n";
+                return false;
+            }
+            options.cacheDir = argv[++i];
+        } else if (arg == "--profile" || arg == "--profile-interval") {
+            if (i + 1 == argc) {
+                std::cerr << arg << " needs a value\n";
+                return false;
+            }
+            std::string value = argv[++i];
+            if (arg == "--profile") {
+                options.profileFile = value;
+            } else {
+                char* end = nullptr;
+                options.profileInterval = std::strtoull(value.c_str(), &end, 10);
+                if (value.empty() || *end != '\0' || options.profileInterval == 0) {
+                    std::cerr << "--profile-interval needs a positive number\n";
+                    return false;
+                }
+            }
+        } else if (arg == "--output" || arg == "--flush") {
+            if (i + 1 == argc) {
+                std::cerr << arg << " needs a value\n";
+                return false;
+            }
+            (arg == "--output" ? options.outputFile : options.flushPolicy) = argv[++i];
+            if (arg == "--flush" && options.flushPolicy != "exit" && options.flushPolicy != "size" && options.flushPolicy != "line") {
+                std::cerr << "Unknown flush policy '" << options.flushPolicy << "'\n";
+                return false;
+            }
+        } else if (isLimitOption(arg)) {
+            if (!parseLimit(arg, i + 1 < argc ? argv[++i] : nullptr, options.limits)) {
+                return false;
+            }
+        } else if (arg == "--memoize") {
+            char* end = nullptr;
+            const char* value = i + 1 < argc ? argv[++i] : "";
+            options.memoEntries = static_cast<size_t>(std::strtoull(value, &end, 10));
+            if (*value == '\0' || *value == '-' || *end != '\0' || options.memoEntries == 0) {
+                std::cerr << "--memoize needs a positive number\n";
+                return false;
+            }
+        } else if (arg == "--threads") {
+            char* end = nullptr;
+            const char* value = i + 1 < argc ? argv[++i] : "";
+            unsigned long threads = std::strtoul(value, &end, 10);
+            if (*value == '\0' || *value == '-' || *end != '\0' || threads == 0) {
+                std::cerr << "--threads needs a positive number\n";
+                return false;
+            }
+            options.threads = static_cast<unsigned>(threads);
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(std::cout);
+            std::exit(0);
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown option '" << arg << "'\n";
+            printUsage(std::cerr);
+            return false;
+        } else if (!options.filename.empty()) {
+            std::cerr << "Too many arguments\n";
+            return false;
+        } else {
+            options.filename = arg;
+        }
+    }
+
+    if (options.filename.empty()) {
+        std::cerr << "Enter filename also\n";
+        printUsage(std::cerr);
+        return false;
+    }
+    return true;
+}
+
+static bool usesParallelBuiltins(const IR& ir) {
+    return std::any_of(ir.instructions.begin(), ir.instructions.end(), [](const IRInstruction& instr) {
+        return instr.opcode == Opcode::PARALLEL_SUM || instr.opcode == Opcode::PARALLEL_COUNT ||
+               instr.opcode == Opcode::PARALLEL_MAX;
+    });
+}
+
+// False if the program stopped with a runtime error or a broken limit, or
+// its output could not be written.
+static bool runProgram(const IR& ir, const Options& options, Instrumentation& stats) {
+    std::unique_ptr<OutputTarget> target;
+    int fd = -1;
+    if (options.outputFile.empty()) {
+        fd = 1;
+        target = std::make_unique<FdOutputTarget>(fd);
+    } else {
+        auto file = std::make_unique<MappedFileOutputTarget>(options.outputFile);
+        if (!file->is_open()) {
+            std::cerr << "Failed to open " << options.outputFile << "\n";
+            return false;
+        }
+        target = std::move(file);
+    }
+
+    FlushPolicy policy = FlushPolicy::THRESHOLD;
+    if (options.flushPolicy == "exit") {
+        policy = FlushPolicy::ON_EXIT;
+    } else if (options.flushPolicy == "line") {
+        policy = FlushPolicy::LINE;
+    } else if (options.flushPolicy.empty() && fd >= 0) {
+        policy = OutputSink::policy_for(fd);
+    }
+    OutputSink output(*target, policy);
+
+    if (options.dumpsAnything()) {
+        std::cout << "\n--- Program Output (from Interpreter) ---\n";
+    }
+    std::cout.flush(); // the sink writes to the descriptor directly
+    // Threads are only started for programs that can use them.
+    std::unique_ptr<simpl::WorkStealingPool> pool;
+    if (usesParallelBuiltins(ir)) {
+        pool = std::make_unique<simpl::WorkStealingPool>(options.threads);
+    }
+    TACInterpreter interpreter(ir, &output); // Create an interpreter instance with the generated IR
+    interpreter.set_parallel_runner(pool.get());
+    if (options.stats || !options.statsJSON.empty()) {
+        interpreter.set_profile(&stats.execution());
+    }
+    SampleProfile samples;
+    samples.interval = options.profileInterval;
+    if (!options.profileFile.empty()) {
+        interpreter.set_sampler(&samples);
+    }
+    interpreter.set_limits(options.limits);
+    interpreter.set_memoization(options.memoEntries);
+    bool ok = interpreter.execute();         // Execute the IR; false after a runtime error
+    if (options.dumpsAnything()) {
+        std::cout << "-------------------------------------------\n";
+    }
+
+    if (!options.profileFile.empty()) {
+        std::ofstream folded(options.profileFile);
+        samples.write_folded(folded);
+        if (!folded) {
+            std::cerr << "Failed to write " << options.profileFile << "\n";
+            return false;
+        }
+    }
+    return ok;
+}
+
+// `batch [--jobs n] [--repeat n] <file.simpl>...`: compiles every file once,
+// runs `repeat` instances of each on a shared thread pool and prints their
+// output in command-line order.
+static int runBatch(int argc, char **argv) {
+    unsigned jobs = 0;
+    size_t repeat = 1;
+    uint64_t slice = 0; // instructions per turn; 0 runs on the pool
+    ExecutionLimits limits;
+    std::vector<std::string> files;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--jobs" || arg == "--repeat" || arg == "--slice") && i + 1 < argc) {
+            const char* text = argv[++i];
+            char* end = nullptr;
+            long value = std::strtol(text, &end, 10);
+            bool parsed = end != text && *end == '\0';
+            if (parsed && arg == "--jobs" && value >= 0) {
+                jobs = static_cast<unsigned>(value); // 0 picks one per core
+            } else if (parsed && arg == "--repeat" && value >= 1) {
+                repeat = static_cast<size_t>(value);
+            } else if (parsed && arg == "--slice" && value >= 1) {
+                slice = static_cast<uint64_t>(value);
+            } else {
+                std::cerr << "Invalid value for " << arg << "\n";
+                return 1;
+            }
+        } else if (isLimitOption(arg)) {
+            if (!parseLimit(arg, i + 1 < argc ? argv[++i] : nullptr, limits)) {
+                return 1;
+            }
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Usage: simpl_lexer batch [--jobs n] [--repeat n] [--slice n] [limits] <file.simpl>...\n";
+            return 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) {
         std::cerr << "Enter filename also\n";
         return 1;
-    } else if(argc > 2) {
-        std::cerr << "Too many arguments\n";
+    }
+
+    std::vector<std::string> sources(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::ifstream inputFile(files[i]);
+        if (!inputFile.is_open()) {
+            std::cerr << "Failed to open " << files[i] << "\n";
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << inputFile.rdbuf();
+        sources[i] = buffer.str();
+    }
+
+    simpl::WorkStealingPool pool(jobs);
+
+    std::vector<std::optional<simpl::Program>> compiled(files.size());
+    std::vector<std::string> compileErrors(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        pool.submit([&, i](unsigned) {
+            try {
+                compiled[i] = simpl::Program::compile(sources[i]);
+            } catch (const simpl::CompileError& e) {
+                for (const std::string& message : e.diagnostics()) {
+                    compileErrors[i] += message;
+                }
+            }
+        });
+    }
+    pool.wait();
+
+    int status = 0;
+    std::vector<simpl::Program> instances;
+    std::vector<size_t> fileOf;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!compiled[i]) {
+            std::cerr << files[i] << ": " << compileErrors[i] << "\n";
+            status = 1;
+            continue;
+        }
+        for (size_t r = 0; r < repeat; ++r) {
+            instances.push_back(*compiled[i]);
+            fileOf.push_back(i);
+        }
+    }
+
+    std::vector<simpl::RunResult> results;
+    if (slice) {
+        TimeSlice turn;
+        turn.instructions = slice;
+        simpl::RoundRobinScheduler scheduler(turn);
+        scheduler.setLimits(limits);
+        for (const simpl::Program& program : instances) {
+            scheduler.add(program);
+        }
+        results = scheduler.runAll();
+    } else {
+        simpl::BatchRunner runner(pool);
+        runner.setLimits(limits);
+        results = runner.run(instances);
+    }
+    for (size_t k = 0; k < results.size(); ++k) {
+        std::cout << results[k].output;
+        if (!results[k].ok) {
+            std::cerr << files[fileOf[k]] << ": " << results[k].error;
+            status = 1;
+        }
+    }
+    return status;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && std::string(argv[1]) == "batch") {
+        return runBatch(argc, argv);
+    }
+
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
         return 1;
     }
 
-    std::string filename = argv[1];
+    const std::string& filename = options.filename;
     
     if (filename.size() < 6 || filename.substr(filename.size() - 6) != ".simpl") {
         std::cerr << "Error: File must have a .simpl extension.\n";
         return 1;
     }
 
+    setAllocationCounting(options.stats || !options.statsJSON.empty());
+    Instrumentation stats(options.timePhases);
+    auto finish = [&](int status) {
+        if (options.stats) {
+            stats.printTable(std::cerr);
+        }
+        if (options.statsJSON == "-") {
+            stats.writeJSON(std::cout);
+        } else if (!options.statsJSON.empty()) {
+            std::ofstream report(options.statsJSON);
+            stats.writeJSON(report);
+            if (!report) {
+                std::cerr << "Failed to write " << options.statsJSON << "\n";
+                return 1;
+            }
+        }
+        return status;
+    };
     std::ifstream inputFile(filename);
 
     if (!inputFile.is_open()) {
@@ -36,6 +437,26 @@ int main(int argc, char **argv) {
     buffer << inputFile.rdbuf();
     std::string code = buffer.str();
 
+    stats.lap("read");
+
+    // A cached program goes straight to the interpreter, unless the caller
+    // asked to see the front end's work.
+    const uint64_t optionsHash = 0; // no options affect code generation yet
+    uint64_t sourceHash = IRCache::hashSource(code);
+    if (!options.cacheDir.empty() && !options.dumpsFrontEnd()) {
+        IR cached;
+        bool hit = IRCache(options.cacheDir).load(sourceHash, optionsHash, cached);
+        stats.lap(hit ? "cache load (hit)" : "cache load (miss)");
+        if (hit) {
+            if (options.dumpIR) {
+                cached.print();
+            }
+            bool ran = runProgram(cached, options, stats);
+            stats.lap("execute");
+            return finish(ran ? 0 : 1);
+        }
+    }
+
     Lexer lexer(code);
     std::vector<Token> tokens;
     Token token;
@@ -44,48 +465,68 @@ int main(int argc, char **argv) {
         token = lexer.getNextToken();
         tokens.push_back(token);
     } while(token.type != TokenType::END_OF_FILE);
+    stats.lap("lex");
 
-    std::cout << "\n--- Tokens ---\n";
-    for (const Token& t : tokens) {
-        std::cout << "Token(" << static_cast<int>(t.type) << ", \"" << t.value << "\", line: " << t.line << ", col: " << t.column << ")\n";
+    if (options.dumpTokens) {
+        std::cout << "\n--- Tokens ---\n";
+        for (const Token& t : tokens) {
+            std::cout << "Token(" << static_cast<int>(t.type) << ", \"" << t.value << "\", line: " << t.line << ", col: " << t.column << ")\n";
+        }
     }
 
-    Parser parser(tokens);
-    std::unique_ptr<ASTNode> root = parser.parseProgram(); 
+    AstArena astArena;
+    Parser parser(tokens, astArena);
+    ParseResult parseResult = parser.parseProgram();
+    AstPtr<ASTNode> root = parseResult.root;
+    stats.lap("parse");
 
-    std::cout << "\n--- AST ---\n";
-    if (root) {
+    if (options.dumpAST) {
+        std::cout << "\n--- AST ---\n";
+    }
+    if (!parseResult.ok()) {
+        for (const ParseError& error : parseResult.errors) {
+            std::cerr << error;
+        }
+        std::cerr << "Parsing failed with " << parseResult.errors.size() << " error(s).\n";
+        return finish(1);
+    }
+    if (options.dumpAST) {
         std::cout << "Parsing completed successfully!\n";
         printAST(root.get()); 
-    } else {
-        std::cerr << "Parsing failed.\n";
     }
 
+    ParallelCompiler compiler;
+    compiler.keepBlockScopes(options.dumpSymbols);
     try {
-        SemanticAnalyzer semanticAnalyzer;
-        semanticAnalyzer.analyze(root.get());  
-        std::cout << "\n--- Semantic Analysis ---\n";
-        std::cout << "Semantic analysis completed successfully!\n";
-
-        semanticAnalyzer.printAllSymbolTables();
+        compiler.compile(parseResult.root.get());
     } catch (const std::runtime_error& e) {
         std::cerr << "Semantic error: " << e.what() << "\n";
-        return 1;
+        stats.lap("analyze + lower");
+        return finish(1);
     }
+    stats.lap("analyze + lower");
+    stats.addDetail("semantic analysis", compiler.timings().analysisMs);
+    stats.addDetail("ir generation", compiler.timings().loweringMs);
 
-    
-    IRGenerator irGenerator;           
-    irGenerator.generate(root.get()); 
-
-    const IR& ir = irGenerator.getIR();
-    ir.print();
+    if (options.dumpSymbols) {
+        std::cout << "\n--- Semantic Analysis ---\n";
+        std::cout << "Semantic analysis completed successfully!\n";
+        compiler.analyzer().printAllSymbolTables();
+    }
 
-    std::cout << "\n--- Program Output (from Interpreter) ---\n";
-    TACInterpreter interpreter(ir); // Create an interpreter instance with the generated IR
-    interpreter.execute();          // Execute the IR
-    std::cout << "-------------------------------------------\n";
+    const IR& ir = compiler.getIR();
+    if (options.dumpIR) {
+        ir.print();
+    }
+    if (!options.cacheDir.empty()) {
+        if (!IRCache(options.cacheDir).store(sourceHash, optionsHash, ir)) {
+            std::cerr << "Warning: could not write IR cache in " << options.cacheDir << "\n";
+        }
+        stats.lap("cache store");
+    }
 
+    bool ran = runProgram(ir, options, stats);
+    stats.lap("execute");
 
-    return 0;
+    return finish(ran ? 0 : 1);
 }
-
@@ -7,24 +7,77 @@
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 class SemanticAnalyzer {
 public:
+    using SymbolTableList = std::vector<std::pair<std::string, std::shared_ptr<SymbolTable>>>;
+
     SemanticAnalyzer() : currentScopeName("global"), currentFunctionExpectedReturnType(Type::UNKNOWN) {}
 
     void analyze(ASTNode *root);
+
+    /*
+        Piecewise analysis for the incremental front end: beginProgram() sets
+        up an empty global scope, then each top-level segment is either
+        analyzed with analyzeStatements() or replayed from an earlier run with
+        declareGlobal() and adoptSymbolTables().
+    */
+    void beginProgram();
+    void analyzeStatements(const BlockNode *block);
+    void declareGlobal(const SymbolInfo &info);
+    size_t symbolTableMark() const { return symbolTableOrder.size(); }
+    SymbolTableList symbolTablesSince(size_t mark) const;
+    void adoptSymbolTables(const SymbolTableList &tables);
+    void analyzeStatement(ASTNode *stmt);
+
+    /*
+        visitFunction split in two for the parallel driver. The signature is
+        entered into the global table serially; the body can then be checked
+        on another analyzer that shares those globals through shareGlobals(),
+        and its inferred return type and purity (left on the FunctionNode)
+        are written back with setFunctionReturnType() and setFunctionPurity()
+        once every worker is done. A function can
+        only call the functions declared at or before `position` in
+        `declarationOrder`, as in a front-to-back pass.
+    */
+    std::vector<std::pair<Type, Symbol>> declareFunctionSignature(const FunctionNode *node);
+    Type analyzeFunctionBody(FunctionNode *node, const std::vector<std::pair<Type, Symbol>> &params);
+    void setFunctionReturnType(Symbol name, Type type);
+    void setFunctionPurity(Symbol name, bool pure);
+    void shareGlobals(const SemanticAnalyzer &owner);
+    void limitVisibleFunctions(const std::unordered_map<Symbol, size_t> *declarationOrder, size_t position);
+
     const SymbolTable &getSymbolTable(const std::string &scopeName) const;
     void printAllSymbolTables() const;
+
+    // Also registers a copy of the function's table as it stands at the end
+    // of every if, else and while body, for printAllSymbolTables(). Off by
+    // default, since the copy costs as much as the whole table.
+    void keepBlockScopes(bool keep) { keepingBlockScopes = keep; }
     int currentLoopDepth = 0;
     Type consolidateFunctionReturnTypes();
 
 
 private:
-    std::unordered_map<std::string, std::unique_ptr<SymbolTable>> allSymbolTables;
+    std::unordered_map<std::string, std::shared_ptr<SymbolTable>> allSymbolTables;
+    std::vector<std::string> symbolTableOrder;
     std::string currentScopeName;
     std::string currentFunctionName;
     Type currentFunctionExpectedReturnType;
     std::vector<Type> foundReturnTypesInCurrentFunction;
+    const std::unordered_map<Symbol, size_t> *functionDeclarationOrder = nullptr;
+    size_t visibleFunctionLimit = 0;
+    bool keepingBlockScopes = false;
+
+    // State of the function body being checked.
+    bool currentFunctionPure = true;
+    bool usedOwnResult = false;          // called itself before its return type was known
+    Type assumedReturnType = Type::UNKNOWN; // what such calls return on a second pass
+
+    Type checkFunctionBody(FunctionNode *node, const std::vector<std::pair<Type, Symbol>> &params);
+    void dropSymbolTablesSince(size_t mark);
 
     void visit(ASTNode *node);
 
@@ -33,22 +86,31 @@ private:
     void visitAssignment(const AssignmentNode *node);
     void visitIfStatement(const IfStatementNode *node);
     void visitWhileLoop(const WhileNode *node);
+    // `body` in a scope of its own on the current function's table.
+    void visitBlockScope(ASTNode *body, const char *kind, int line, int col);
     void visitBlock(const BlockNode *node);
     void visitReturn(const ReturnNode *node);
-    void visitFunction(const FunctionNode *node);
-    void visitCallExpr(const CallExprNode *node);
+    void visitFunction(FunctionNode *node);
+    Type visitCallExpr(CallExprNode *node);
+    // The global `name` as seen from the body being checked, or null if it
+    // is not declared there.
+    const SymbolInfo *findVisibleGlobal(Symbol name);
     void visitPrint(const PrintNode *node);
 
-    Type evaluateExpression(const std::unique_ptr<ASTNode> &node);
+    Type evaluateExpression(const AstPtr<ASTNode> &node);
+    Type inferExpressionType(const AstPtr<ASTNode> &node);
     Type visitBinaryExpr(const BinaryExprNode *node);
     Type visitUnaryExpr(const UnaryExprNode *node);
     Type visitNumberLiteral();
     Type visitStringLiteral();
     Type visitComparisonExpr(const ComparisonNode *node);
     Type visitLogicalExpr(const LogicalExprNode *node);
+    Type visitArrayAlloc(const ArrayAllocNode *node);
+    Type visitIndex(const IndexNode *node);
 
 
     SymbolTable &getCurrentSymbolTable();
+    void registerSymbolTable(const std::string &scopeName, std::shared_ptr<SymbolTable> table);
 };
 
 #endif
\ No newline at end of file
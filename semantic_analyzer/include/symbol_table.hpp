@@ -1,73 +1,111 @@
 #ifndef SYMBOL_TABLE_HPP
 #define SYMBOL_TABLE_HPP
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include "../../Lexer/interner.hpp"
+#include "../../Parser/ast.hpp"
 
-enum class Type {
-    NUMBER,
-    STRING,
-    VOID,
-    UNKNOWN
+// Function-only details, kept out of line so variable entries stay small.
+struct FunctionSignature {
+    std::vector<std::pair<Type, Symbol>> params;
+    std::vector<std::string> childScopes;
 };
 
 struct SymbolInfo {
-    std::string name;
+    Symbol name;
     Type type;
-    std::vector<std::pair<Type, std::string>> params;
     Type returns;
-    std::string parentScope;
-    std::vector<std::string> childScopes;
     bool isFunction;
     bool isInitialized;
+    bool isPure = false; // function with no side effects, see FunctionNode::pure
+    int slot = -1; // frame slot of a variable, numbered per table
+    std::shared_ptr<const FunctionSignature> signature; // null for variables
 
     SymbolInfo(
-        const std::string &name = "",
+        Symbol name = 0,
         Type type = Type::UNKNOWN,
-        const std::vector<std::pair<Type, std::string>> &params = {},
         Type returns = Type::UNKNOWN,
-        const std::string &parentScope = "",
-        const std::vector<std::string> &childScopes = {},
         bool isFunction = false,
         bool isInitialized = false)
         : name(name),
           type(type),
-          params(params),
           returns(returns),
-          parentScope(parentScope),
-          childScopes(childScopes),
           isFunction(isFunction),
           isInitialized(isInitialized) {}
+
+    const std::vector<std::pair<Type, Symbol>> &params() const;
 };
 
+/*
+    Scoped symbol table. Instead of one hash map per scope, every name has a
+    single open-addressed bucket pointing at its innermost declaration, and
+    each declaration remembers the one it shadows. Declarations are pushed on
+    one stack and a scope is just the stack height at enterScope(), so
+    exitScope() undoes exactly the declarations made in that scope.
+*/
 class SymbolTable {
 public:
     SymbolTable(const std::string &scopeName = "global") : currentScopeName(scopeName) {
-        scopes.emplace_back();
+        scopeStarts.push_back(0);
+        buckets.resize(INITIAL_BUCKETS);
     }
-    bool isDeclaredInCurrentScope(const std::string &name) const;
+    bool isDeclaredInCurrentScope(Symbol name) const;
     void print(int) const;
-    void printScope(const std::unordered_map<std::string, SymbolInfo> &) const;
-    void enterScope(const std::string &scopeName);
+    void printScope(const std::unordered_map<Symbol, SymbolInfo> &) const;
+    void enterScope();
     void exitScope();
-    bool declare(const std::string &name, Type type, bool isInitialized = false);
-    bool declareFunction(const std::string &name, Type returnType, const std::vector<std::pair<Type, std::string>> &params);
-    void updateFunctionReturnType(const std::string& name, Type newType);
-    bool assign(const std::string &name);
-    bool isDeclared(const std::string &name) const;
-    bool isInitialized(const std::string &name) const;
-    Type getType(const std::string &name) const;
-    SymbolInfo getSymbolInfo(const std::string &name) const;
+    bool declare(Symbol name, Type type, bool isInitialized = false);
+    bool declareFunction(Symbol name, Type returnType, const std::vector<std::pair<Type, Symbol>> &params);
+    void define(const SymbolInfo &info); // insert or replace in the innermost scope
+    void updateFunctionReturnType(Symbol name, Type newType);
+    void updateFunctionPurity(Symbol name, bool pure);
+    bool assign(Symbol name);
+    bool isDeclared(Symbol name) const;
+    bool isInitialized(Symbol name) const;
+    Type getType(Symbol name) const;
+    SymbolInfo getSymbolInfo(Symbol name) const;
+
+    // Innermost visible declaration of `name`, or null. `depth` receives the
+    // scope level it was declared at. The pointer is only valid until the
+    // next declaration.
+    const SymbolInfo *lookup(Symbol name, int *depth = nullptr) const;
+    SymbolInfo *lookup(Symbol name, int *depth = nullptr);
+    int frameSize() const { return nextSlot; }
 
     const std::string &getCurrentScopeName() const { return currentScopeName; }
-    std::unordered_map<std::string, SymbolInfo> getScope() const;
+    void setScopeName(const std::string &scopeName) { currentScopeName = scopeName; }
+    std::unordered_map<Symbol, SymbolInfo> getScope() const;
 
 
 private:
-    std::vector<std::unordered_map<std::string, SymbolInfo>> scopes;
+    static constexpr size_t INITIAL_BUCKETS = 16;
+
+    struct Declaration {
+        SymbolInfo info;
+        int shadowed; // previous declaration of the same name, or -1
+    };
+
+    struct Bucket {
+        Symbol name = 0; // 0 (the empty string) marks a free bucket
+        int top = -1;    // innermost declaration, or -1
+    };
+
+    std::vector<Declaration> declarations;
+    std::vector<size_t> scopeStarts; // declarations.size() when each scope was entered
+    std::vector<Bucket> buckets;
+    size_t usedBuckets = 0;
+    int nextSlot = 0;
 
     std::string currentScopeName;
+
+    size_t findBucket(Symbol name) const;
+    Bucket &bucketFor(Symbol name);
+    SymbolInfo &push(const SymbolInfo &info);
+    int levelOf(int declaration) const;
+    SymbolInfo &outermostFunction(Symbol name, const char *update);
 };
 
 std::string typeToString(Type t);
@@ -1,14 +1,43 @@
 #include "../include/semantic_analyzer.hpp"
 #include "../include/symbol_table.hpp"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 
-static int scopeCounter = 0;
+namespace {
+
+struct BuiltinFunction {
+    const char *name;
+    Builtin id;
+    std::vector<Type> params;
+    Type returns;
+    bool takesFunction = false; // first argument names a pure number -> number function, before `params`
+};
+
+// Built-in functions are pure and their names are reserved.
+const BuiltinFunction builtinFunctions[] = {
+    {"len", Builtin::LEN, {Type::NUMBER_ARRAY}, Type::NUMBER},
+    {"parallelSum", Builtin::PARALLEL_SUM, {Type::NUMBER, Type::NUMBER}, Type::NUMBER, true},
+    {"parallelCount", Builtin::PARALLEL_COUNT, {Type::NUMBER, Type::NUMBER}, Type::NUMBER, true},
+    {"parallelMax", Builtin::PARALLEL_MAX, {Type::NUMBER, Type::NUMBER}, Type::NUMBER, true},
+};
+
+const BuiltinFunction *findBuiltin(Symbol name) {
+    const std::string &text = symbolName(name);
+    for (const BuiltinFunction &builtin : builtinFunctions) {
+        if (text == builtin.name) {
+            return &builtin;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
 std::string generateUniqueScopeName(const std::string &baseName, int line, int col) {
     std::stringstream ss;
     ss << baseName << "$" << std::to_string(line + 1) << "$" << std::to_string(col);
-    scopeCounter++;
     return ss.str();
 }
 
@@ -56,16 +85,80 @@ SymbolTable &SemanticAnalyzer::getCurrentSymbolTable() {
     return *it->second;
 }
 
-void SemanticAnalyzer::analyze(ASTNode *root) {
-    allSymbolTables["global"] = std::make_unique<SymbolTable>("global");
+void SemanticAnalyzer::registerSymbolTable(const std::string &scopeName, std::shared_ptr<SymbolTable> table) {
+    allSymbolTables[scopeName] = std::move(table);
+    symbolTableOrder.push_back(scopeName);
+}
+
+void SemanticAnalyzer::beginProgram() {
+    allSymbolTables.clear();
+    symbolTableOrder.clear();
+    registerSymbolTable("global", std::make_shared<SymbolTable>("global"));
     currentScopeName = "global";
     currentFunctionName = "";
     currentFunctionExpectedReturnType = Type::UNKNOWN;
+}
 
-    if (auto programBlock = dynamic_cast<BlockNode *>(root)) {
-        for (const auto &stmt : programBlock->statements) {
-            visit(stmt.get());
-        }
+void SemanticAnalyzer::analyzeStatements(const BlockNode *block) {
+    for (const auto &stmt : block->statements) {
+        visit(stmt.get());
+    }
+}
+
+void SemanticAnalyzer::analyzeStatement(ASTNode *stmt) {
+    visit(stmt);
+}
+
+void SemanticAnalyzer::shareGlobals(const SemanticAnalyzer &owner) {
+    allSymbolTables["global"] = owner.allSymbolTables.at("global");
+    currentScopeName = "global";
+    currentFunctionName = "";
+    currentFunctionExpectedReturnType = Type::UNKNOWN;
+}
+
+void SemanticAnalyzer::limitVisibleFunctions(const std::unordered_map<Symbol, size_t> *declarationOrder, size_t position) {
+    functionDeclarationOrder = declarationOrder;
+    visibleFunctionLimit = position;
+}
+
+void SemanticAnalyzer::setFunctionReturnType(Symbol name, Type type) {
+    allSymbolTables["global"]->updateFunctionReturnType(name, type);
+}
+
+void SemanticAnalyzer::setFunctionPurity(Symbol name, bool pure) {
+    allSymbolTables["global"]->updateFunctionPurity(name, pure);
+}
+
+void SemanticAnalyzer::declareGlobal(const SymbolInfo &info) {
+    allSymbolTables["global"]->define(info);
+}
+
+SemanticAnalyzer::SymbolTableList SemanticAnalyzer::symbolTablesSince(size_t mark) const {
+    SymbolTableList tables;
+    for (size_t i = mark; i < symbolTableOrder.size(); ++i) {
+        tables.emplace_back(symbolTableOrder[i], allSymbolTables.at(symbolTableOrder[i]));
+    }
+    return tables;
+}
+
+void SemanticAnalyzer::dropSymbolTablesSince(size_t mark) {
+    for (size_t i = mark; i < symbolTableOrder.size(); ++i) {
+        allSymbolTables.erase(symbolTableOrder[i]);
+    }
+    symbolTableOrder.resize(mark);
+}
+
+void SemanticAnalyzer::adoptSymbolTables(const SymbolTableList &tables) {
+    for (const auto &[scopeName, table] : tables) {
+        registerSymbolTable(scopeName, table);
+    }
+}
+
+void SemanticAnalyzer::analyze(ASTNode *root) {
+    beginProgram();
+
+    if (auto programBlock = ast_cast<BlockNode>(root)) {
+        analyzeStatements(programBlock);
     } else {
         visit(root);
     }
@@ -75,26 +168,39 @@ void SemanticAnalyzer::visit(ASTNode *node) {
     if (!node)
         return;
 
-    if (auto decl = dynamic_cast<DeclarationNode *>(node)) {
-        visitDeclaration(decl);
-    } else if (auto var = dynamic_cast<VariableNode *>(node)) {
-        visitVariable(var);
-    } else if (auto assign = dynamic_cast<AssignmentNode *>(node)) {
-        visitAssignment(assign);
-    } else if (auto ifStmt = dynamic_cast<IfStatementNode *>(node)) {
-        visitIfStatement(ifStmt);
-    } else if (auto whileStmt = dynamic_cast<WhileNode *>(node)) {
-        visitWhileLoop(whileStmt);
-    } else if (auto block = dynamic_cast<BlockNode *>(node)) {
-        visitBlock(block);
-    } else if (auto ret = dynamic_cast<ReturnNode *>(node)) {
-        visitReturn(ret);
-    } else if (auto func = dynamic_cast<FunctionNode *>(node)) {
-        visitFunction(func);
-    } else if (auto call = dynamic_cast<CallExprNode *>(node)) {
-        evaluateExpression(std::unique_ptr<ASTNode>(call));
-    } else if (auto print = dynamic_cast<PrintNode *>(node)) {
-        visitPrint(print);
+    switch (node->kind) {
+        case NodeKind::Declaration:
+            visitDeclaration(static_cast<DeclarationNode *>(node));
+            break;
+        case NodeKind::Variable:
+            visitVariable(static_cast<VariableNode *>(node));
+            break;
+        case NodeKind::Assignment:
+            visitAssignment(static_cast<AssignmentNode *>(node));
+            break;
+        case NodeKind::IfStatement:
+            visitIfStatement(static_cast<IfStatementNode *>(node));
+            break;
+        case NodeKind::While:
+            visitWhileLoop(static_cast<WhileNode *>(node));
+            break;
+        case NodeKind::Block:
+            visitBlock(static_cast<BlockNode *>(node));
+            break;
+        case NodeKind::Return:
+            visitReturn(static_cast<ReturnNode *>(node));
+            break;
+        case NodeKind::Function:
+            visitFunction(static_cast<FunctionNode *>(node));
+            break;
+        case NodeKind::CallExpr:
+            evaluateExpression(AstPtr<ASTNode>(node));
+            break;
+        case NodeKind::Print:
+            visitPrint(static_cast<PrintNode *>(node));
+            break;
+        default:
+            break;
     }
 }
 
@@ -104,6 +210,8 @@ void SemanticAnalyzer::visitDeclaration(const DeclarationNode *node) {
         type = Type::NUMBER;
     } else if (node->type == TokenType::STRING) {
         type = Type::STRING;
+    } else if (node->type == TokenType::NUMBER_ARRAY) {
+        type = Type::NUMBER_ARRAY;
     } else {
         throw std::runtime_error("Unknown variable type in declaration: " + typeToString(type));
     }
@@ -111,52 +219,70 @@ void SemanticAnalyzer::visitDeclaration(const DeclarationNode *node) {
     SymbolTable &currentTable = getCurrentSymbolTable();
 
     for (const auto &decl : node->declarations) {
-        std::string name = decl->name.value;
+        Symbol name = decl->name.symbol;
 
         if (currentTable.isDeclaredInCurrentScope(name)) {
-            throw std::runtime_error("Variable '" + name + "' already declared in current scope.");
+            throw std::runtime_error("Variable '" + symbolName(name) + "' already declared in current scope.");
         }
 
         Type initType = Type::UNKNOWN;
-        bool isInitialized = false;
+        bool isInitialized = type == Type::NUMBER_ARRAY; // starts out empty
         if (decl->initializer) {
             initType = evaluateExpression(decl->initializer);
             if (initType != type) {
-                throw std::runtime_error("Type mismatch in initialization of variable '" + name +
+                throw std::runtime_error("Type mismatch in initialization of variable '" + symbolName(name) +
                                          "'. Expected " + typeToString(type) + ", got " + typeToString(initType));
             }
             isInitialized = true;
         }
         currentTable.declare(name, type, isInitialized);
+        decl->slot = currentTable.lookup(name)->slot;
     }
 }
 
 void SemanticAnalyzer::visitVariable(const VariableNode *node) {
-    if (!getCurrentSymbolTable().isDeclared(node->name)) {
-        throw std::runtime_error("Undeclared variable: " + node->name);
+    if (!getCurrentSymbolTable().lookup(node->name)) {
+        throw std::runtime_error("Undeclared variable: " + symbolName(node->name));
     }
 }
 
 void SemanticAnalyzer::visitAssignment(const AssignmentNode *node) {
-    auto varNode = dynamic_cast<VariableNode *>(node->left.get());
+    if (ast_cast<IndexNode>(node->left.get())) {
+        evaluateExpression(node->left);
+        Type rhsType = evaluateExpression(node->rightExpression);
+        if (rhsType != Type::NUMBER) {
+            throw std::runtime_error("Type mismatch in assignment to an element of a number[]. Expected number, got " +
+                                     typeToString(rhsType));
+        }
+        // The array may be shared with the caller.
+        currentFunctionPure = false;
+        return;
+    }
+
+    auto varNode = ast_cast<VariableNode>(node->left.get());
     if (!varNode)
         throw std::runtime_error("Left-hand side of assignment must be a variable.");
 
-    std::string name = varNode->name;
+    Symbol name = varNode->name;
     SymbolTable &currentTable = getCurrentSymbolTable();
 
-    if (!currentTable.isDeclared(name)) {
-        throw std::runtime_error("Assignment to undeclared variable: " + name);
+    int depth = 0;
+    SymbolInfo *info = currentTable.lookup(name, &depth);
+    if (!info) {
+        throw std::runtime_error("Assignment to undeclared variable: " + symbolName(name));
     }
+    varNode->depth = depth;
+    varNode->slot = info->slot;
+    varNode->valueType = info->type;
 
-    Type lhsType = currentTable.getType(name);
+    Type lhsType = info->type;
     Type rhsType = evaluateExpression(node->rightExpression);
 
     if (lhsType != rhsType) {
-        throw std::runtime_error("Type mismatch in assignment to variable '" + name +
+        throw std::runtime_error("Type mismatch in assignment to variable '" + symbolName(name) +
                                  "'. Expected " + typeToString(lhsType) + ", got " + typeToString(rhsType));
     }
-    currentTable.assign(name);
+    info->isInitialized = true;
 }
 
 void SemanticAnalyzer::visitIfStatement(const IfStatementNode *node) {
@@ -168,23 +294,11 @@ void SemanticAnalyzer::visitIfStatement(const IfStatementNode *node) {
         if (condType != Type::NUMBER) {
             throw std::runtime_error("Condition in if-statement must evaluate to a numeric (boolean) type.");
         }
-        std::string blockScopeName = generateUniqueScopeName("if", node->line, node->col);
-        SymbolTable &activeSymbolTable = getCurrentSymbolTable();
-
-        activeSymbolTable.enterScope(blockScopeName);
-        visit(body.get());
-        allSymbolTables[blockScopeName] = std::make_unique<SymbolTable>(activeSymbolTable);
-        activeSymbolTable.exitScope();
+        visitBlockScope(body.get(), "if", node->line, node->col);
     }
 
     if (node->elseBranch) {
-        std::string elseScopeName = generateUniqueScopeName("else", node->line, node->col);
-        SymbolTable &activeSymbolTable = getCurrentSymbolTable();
-        activeSymbolTable.enterScope(elseScopeName);
-
-        visit(node->elseBranch.get());
-        allSymbolTables[elseScopeName] = std::make_unique<SymbolTable>(activeSymbolTable);
-        activeSymbolTable.exitScope();
+        visitBlockScope(node->elseBranch.get(), "else", node->line, node->col);
     }
 }
 
@@ -194,11 +308,16 @@ void SemanticAnalyzer::visitWhileLoop(const WhileNode *node) {
         throw std::runtime_error("Condition in while-loop must evaluate to a numeric (boolean) type.");
     }
 
-    std::string blockScopeName = generateUniqueScopeName("while", node->line, node->col);
+    visitBlockScope(node->whileBlock.get(), "while", node->line, node->col);
+}
+
+void SemanticAnalyzer::visitBlockScope(ASTNode *body, const char *kind, int line, int col) {
     SymbolTable &activeSymbolTable = getCurrentSymbolTable();
-    activeSymbolTable.enterScope(blockScopeName);
-    visit(node->whileBlock.get());
-    allSymbolTables[blockScopeName] = std::make_unique<SymbolTable>(activeSymbolTable);
+    activeSymbolTable.enterScope();
+    visit(body);
+    if (keepingBlockScopes) {
+        registerSymbolTable(generateUniqueScopeName(kind, line, col), std::make_shared<SymbolTable>(activeSymbolTable));
+    }
     activeSymbolTable.exitScope();
 }
 
@@ -222,146 +341,283 @@ void SemanticAnalyzer::visitReturn(const ReturnNode *node) {
     foundReturnTypesInCurrentFunction.push_back(actualReturnType);
 }
 
-void SemanticAnalyzer::visitFunction(const FunctionNode *node) {
-    std::string functionName = node->name;
+void SemanticAnalyzer::visitFunction(FunctionNode *node) {
+    std::vector<std::pair<Type, Symbol>> paramInfoList = declareFunctionSignature(node);
+    Type inferredReturnType = analyzeFunctionBody(node, paramInfoList);
+    setFunctionReturnType(node->name, inferredReturnType);
+    setFunctionPurity(node->name, node->pure);
+}
+
+std::vector<std::pair<Type, Symbol>> SemanticAnalyzer::declareFunctionSignature(const FunctionNode *node) {
+    Symbol functionName = node->name;
+    const std::string &functionNameText = symbolName(functionName);
 
     Type declaredReturnType = Type::UNKNOWN; 
 
-    std::vector<std::pair<Type, std::string>> paramInfoList;
+    std::vector<std::pair<Type, Symbol>> paramInfoList;
     for (const auto &param : node->parameters) {
         Type paramType = Type::UNKNOWN;
         if (param.first == "number") {
             paramType = Type::NUMBER;
         } else if (param.first == "string") {
             paramType = Type::STRING;
+        } else if (param.first == "number[]") {
+            paramType = Type::NUMBER_ARRAY;
         } else {
-            throw std::runtime_error("Unknown parameter type '" + param.first + "' for parameter '" + param.second + "' in function '" + functionName + "'.");
+            throw std::runtime_error("Unknown parameter type '" + param.first + "' for parameter '" + symbolName(param.second) + "' in function '" + functionNameText + "'.");
         }
         paramInfoList.push_back({paramType, param.second});
     }
 
+    if (findBuiltin(functionName)) {
+        throw std::runtime_error("Function '" + functionNameText + "' is built in and cannot be redeclared.");
+    }
     SymbolTable &globalTable = *allSymbolTables["global"];
     if (globalTable.isDeclared(functionName)) {
-        throw std::runtime_error("Function '" + functionName + "' already declared globally.");
+        throw std::runtime_error("Function '" + functionNameText + "' already declared globally.");
     }
     globalTable.declareFunction(functionName, declaredReturnType, paramInfoList);
+    return paramInfoList;
+}
+
+/*
+    A function's return type is only known once its whole body has been
+    checked, so a body that uses its own result, as in
+    `return fib(n - 1) + fib(n - 2);`, fails on the first pass. When it did
+    and an earlier return already showed the type, the body is checked again
+    with its own calls assumed to return that type; the usual consistency
+    check on the returns then confirms the assumption.
+*/
+Type SemanticAnalyzer::analyzeFunctionBody(FunctionNode *node, const std::vector<std::pair<Type, Symbol>> &paramInfoList) {
+    size_t mark = symbolTableMark();
+    std::string scopeName = currentScopeName;
+    std::string functionName = currentFunctionName;
+    Type expectedReturnType = currentFunctionExpectedReturnType;
+    int loopDepth = currentLoopDepth;
+
+    assumedReturnType = Type::UNKNOWN;
+    try {
+        return checkFunctionBody(node, paramInfoList);
+    } catch (const std::runtime_error &) {
+        auto known = std::find_if(foundReturnTypesInCurrentFunction.begin(), foundReturnTypesInCurrentFunction.end(),
+                                  [](Type type) { return type != Type::VOID && type != Type::UNKNOWN; });
+        if (!usedOwnResult || known == foundReturnTypesInCurrentFunction.end()) {
+            throw;
+        }
+        assumedReturnType = *known;
+    }
+
+    dropSymbolTablesSince(mark);
+    currentScopeName = scopeName;
+    currentFunctionName = functionName;
+    currentFunctionExpectedReturnType = expectedReturnType;
+    currentLoopDepth = loopDepth;
+    Type inferredReturnType = checkFunctionBody(node, paramInfoList);
+    assumedReturnType = Type::UNKNOWN;
+    return inferredReturnType;
+}
 
-    std::string funcUniqueScopeName = generateUniqueScopeName(functionName, node->line, node->col);
-    allSymbolTables[funcUniqueScopeName] = std::make_unique<SymbolTable>(funcUniqueScopeName);
+Type SemanticAnalyzer::checkFunctionBody(FunctionNode *node, const std::vector<std::pair<Type, Symbol>> &paramInfoList) {
+    const std::string &functionNameText = symbolName(node->name);
+
+    std::string funcUniqueScopeName = generateUniqueScopeName(functionNameText, node->line, node->col);
+    registerSymbolTable(funcUniqueScopeName, std::make_shared<SymbolTable>(funcUniqueScopeName));
 
     std::string previousScopeName = currentScopeName;
     std::string previousFunctionName = currentFunctionName;
     Type previousFunctionExpectedReturnType = currentFunctionExpectedReturnType; 
+    bool previousFunctionPure = currentFunctionPure;
 
     currentScopeName = funcUniqueScopeName;
-    currentFunctionName = functionName;
-    currentFunctionExpectedReturnType = declaredReturnType; 
+    currentFunctionName = functionNameText;
+    currentFunctionExpectedReturnType = Type::UNKNOWN; 
 
     foundReturnTypesInCurrentFunction.clear();
+    currentFunctionPure = true;
+    usedOwnResult = false;
 
     SymbolTable &funcTable = getCurrentSymbolTable();
 
     for (const auto &paramData : paramInfoList) {
         if (!funcTable.declare(paramData.second, paramData.first, true)) {
-            throw std::runtime_error("Failed to declare parameter '" + paramData.second + "' in function '" + functionName + "'.");
+            throw std::runtime_error("Failed to declare parameter '" + symbolName(paramData.second) + "' in function '" + functionNameText + "'.");
         }
     }
 
     if (node->functionBlock) {
-        BlockNode *bodyBlock = dynamic_cast<BlockNode *>(node->functionBlock.get());
+        BlockNode *bodyBlock = ast_cast<BlockNode>(node->functionBlock.get());
         if (bodyBlock) {
             for (const auto &stmt : bodyBlock->statements) {
                 visit(stmt.get());
             }
         } else {
             if (node->functionBlock.get() != nullptr) {
-                throw std::runtime_error("Function '" + functionName + "' has a body that is not a valid block of statements.");
+                throw std::runtime_error("Function '" + functionNameText + "' has a body that is not a valid block of statements.");
             }
         }
     }
 
     Type inferredReturnType = consolidateFunctionReturnTypes();
+    node->frameSize = funcTable.frameSize();
+    node->pure = currentFunctionPure;
+    node->memoizable = currentFunctionPure && inferredReturnType == Type::NUMBER &&
+                       std::all_of(paramInfoList.begin(), paramInfoList.end(),
+                                   [](const std::pair<Type, Symbol> &param) { return param.first == Type::NUMBER; });
 
-    globalTable.updateFunctionReturnType(functionName, inferredReturnType);
-
-    if (functionName == "main" && inferredReturnType != Type::VOID) {
+    if (functionNameText == "main" && inferredReturnType != Type::VOID) {
          throw std::runtime_error("Function 'main' must not return a value. Detected return type: " + typeToString(inferredReturnType));
     }
 
     currentScopeName = previousScopeName;
     currentFunctionName = previousFunctionName;
     currentFunctionExpectedReturnType = previousFunctionExpectedReturnType; 
+    currentFunctionPure = previousFunctionPure;
+    return inferredReturnType;
 }
 
-void SemanticAnalyzer::visitCallExpr(const CallExprNode *node) {
-    std::string functionName = node->functionName;
-    SymbolTable &globalTable = *allSymbolTables["global"];
+Type SemanticAnalyzer::visitCallExpr(CallExprNode *node) {
+    Symbol functionName = node->functionName;
+    const std::string &functionNameText = symbolName(functionName);
 
-    if (!globalTable.isDeclared(functionName)) {
-        throw std::runtime_error("Call to undeclared function: " + functionName);
+    if (const BuiltinFunction *builtin = findBuiltin(functionName)) {
+        size_t first = builtin->takesFunction ? 1 : 0;
+        if (node->arguments.size() != first + builtin->params.size()) {
+            throw std::runtime_error("Mismatched number of arguments for built-in function '" + functionNameText +
+                                     "'. Expected " + std::to_string(first + builtin->params.size()) +
+                                     ", got " + std::to_string(node->arguments.size()) + ".");
+        }
+        if (builtin->takesFunction) {
+            // Called from several threads at once, so it has to be pure.
+            const VariableNode *argument = ast_cast<VariableNode>(node->arguments[0].get());
+            const SymbolInfo *function = argument ? findVisibleGlobal(argument->name) : nullptr;
+            if (!function || !function->isFunction) {
+                throw std::runtime_error("The first argument of built-in function '" + functionNameText +
+                                         "' must name a function.");
+            }
+            const std::string &name = symbolName(argument->name);
+            if (function->params().size() != 1 || function->params()[0].first != Type::NUMBER ||
+                function->returns != Type::NUMBER) {
+                throw std::runtime_error("Function '" + name + "' passed to '" + functionNameText +
+                                         "' must take one number and return a number.");
+            }
+            if (!function->isPure) {
+                throw std::runtime_error("Function '" + name + "' passed to '" + functionNameText +
+                                         "' must be pure: it may not print, write to an array or call an impure function.");
+            }
+        }
+        for (size_t i = first; i < node->arguments.size(); ++i) {
+            Type argType = evaluateExpression(node->arguments[i]);
+            if (argType != builtin->params[i - first]) {
+                throw std::runtime_error("Type mismatch for argument " + std::to_string(i + 1) +
+                                         " in call to built-in function '" + functionNameText +
+                                         "'. Expected " + typeToString(builtin->params[i - first]) +
+                                         ", got " + typeToString(argType) + ".");
+            }
+        }
+        node->builtin = builtin->id;
+        return builtin->returns;
     }
 
-    SymbolInfo funcInfo = globalTable.getSymbolInfo(functionName);
-    if (!funcInfo.isFunction) {
-        throw std::runtime_error("'" + functionName + "' is not a function.");
+    const SymbolInfo *funcInfo = findVisibleGlobal(functionName);
+    if (!funcInfo) {
+        throw std::runtime_error("Call to undeclared function: " + functionNameText);
     }
 
-    if (node->arguments.size() != funcInfo.params.size()) {
-        throw std::runtime_error("Mismatched number of arguments for function '" + functionName +
-                                 "'. Expected " + std::to_string(funcInfo.params.size()) +
+    if (!funcInfo->isFunction) {
+        throw std::runtime_error("'" + functionNameText + "' is not a function.");
+    }
+
+    bool selfCall = functionNameText == currentFunctionName;
+    if (!funcInfo->isPure && !selfCall) {
+        currentFunctionPure = false;
+    }
+
+    if (node->arguments.size() != funcInfo->params().size()) {
+        throw std::runtime_error("Mismatched number of arguments for function '" + functionNameText +
+                                 "'. Expected " + std::to_string(funcInfo->params().size()) +
                                  ", got " + std::to_string(node->arguments.size()) + ".");
     }
 
     for (size_t i = 0; i < node->arguments.size(); ++i) {
         Type argType = evaluateExpression(node->arguments[i]);
-        if (argType != funcInfo.params[i].first) {
+        if (argType != funcInfo->params()[i].first) {
             throw std::runtime_error("Type mismatch for argument " + std::to_string(i + 1) +
-                                     " in call to function '" + functionName +
-                                     "'. Expected " + typeToString(funcInfo.params[i].first) +
+                                     " in call to function '" + functionNameText +
+                                     "'. Expected " + typeToString(funcInfo->params()[i].first) +
                                      ", got " + typeToString(argType) + ".");
         }
     }
+    if (selfCall && funcInfo->returns == Type::UNKNOWN) {
+        usedOwnResult = true;
+        return assumedReturnType;
+    }
+    return funcInfo->returns;
+}
+
+const SymbolInfo *SemanticAnalyzer::findVisibleGlobal(Symbol name) {
+    const SymbolInfo *info = allSymbolTables["global"]->lookup(name);
+    if (info && functionDeclarationOrder) {
+        auto order = functionDeclarationOrder->find(name);
+        if (order != functionDeclarationOrder->end() && order->second > visibleFunctionLimit) {
+            return nullptr;
+        }
+    }
+    return info;
 }
 
 void SemanticAnalyzer::visitPrint(const PrintNode *node) {
+    currentFunctionPure = false;
     evaluateExpression(node->expression);
 }
 
-Type SemanticAnalyzer::evaluateExpression(const std::unique_ptr<ASTNode> &node) {
+// Types an expression and records the result on the node for the later phases.
+Type SemanticAnalyzer::evaluateExpression(const AstPtr<ASTNode> &node) {
+    Type type = inferExpressionType(node);
+    if (node) {
+        node->valueType = type;
+    }
+    return type;
+}
+
+Type SemanticAnalyzer::inferExpressionType(const AstPtr<ASTNode> &node) {
     if (!node)
         return Type::UNKNOWN;
 
-    if (auto bin = dynamic_cast<BinaryExprNode *>(node.get())) {
-        return visitBinaryExpr(bin);
-    } else if (auto un = dynamic_cast<UnaryExprNode *>(node.get())) {
-        return visitUnaryExpr(un);
-    } else if (dynamic_cast<NumberLiteralNode *>(node.get())) {
-        return visitNumberLiteral();
-    } else if (dynamic_cast<StringLiteralNode *>(node.get())) {
-        return visitStringLiteral();
-    } else if (auto var = dynamic_cast<VariableNode *>(node.get())) {
-        SymbolTable &currentTable = getCurrentSymbolTable();
-        if (!currentTable.isDeclared(var->name)) {
-            throw std::runtime_error("Undeclared variable used in expression: " + var->name);
-        }
-        if (!currentTable.isInitialized(var->name)) {
-            throw std::runtime_error("Variable '" + var->name + "' used before initialization.");
-        }
-        return currentTable.getType(var->name);
-    } else if (auto comp = dynamic_cast<ComparisonNode *>(node.get())) {
-        return visitComparisonExpr(comp);
-    } else if (auto logic = dynamic_cast<LogicalExprNode *>(node.get())) {
-        return visitLogicalExpr(logic);
-    } else if (auto call = dynamic_cast<CallExprNode *>(node.get())) {
-        visitCallExpr(call);
-        SymbolTable &globalTable = *allSymbolTables["global"];
-        if (globalTable.isDeclared(call->functionName)) {
-            SymbolInfo funcInfo = globalTable.getSymbolInfo(call->functionName);
-            if (funcInfo.isFunction) {
-                return funcInfo.returns;
+    switch (node->kind) {
+        case NodeKind::BinaryExpr:
+            return visitBinaryExpr(static_cast<BinaryExprNode *>(node.get()));
+        case NodeKind::UnaryExpr:
+            return visitUnaryExpr(static_cast<UnaryExprNode *>(node.get()));
+        case NodeKind::NumberLiteral:
+            return visitNumberLiteral();
+        case NodeKind::StringLiteral:
+            return visitStringLiteral();
+        case NodeKind::Variable: {
+            auto var = static_cast<VariableNode *>(node.get());
+            int depth = 0;
+            const SymbolInfo *info = getCurrentSymbolTable().lookup(var->name, &depth);
+            if (!info) {
+                throw std::runtime_error("Undeclared variable used in expression: " + symbolName(var->name));
+            }
+            if (!info->isInitialized) {
+                throw std::runtime_error("Variable '" + symbolName(var->name) + "' used before initialization.");
             }
+            var->depth = depth;
+            var->slot = info->slot;
+            return info->type;
         }
-        return Type::UNKNOWN;
+        case NodeKind::Comparison:
+            return visitComparisonExpr(static_cast<ComparisonNode *>(node.get()));
+        case NodeKind::LogicalExpr:
+            return visitLogicalExpr(static_cast<LogicalExprNode *>(node.get()));
+        case NodeKind::CallExpr:
+            return visitCallExpr(static_cast<CallExprNode *>(node.get()));
+        case NodeKind::ArrayAlloc:
+            return visitArrayAlloc(static_cast<ArrayAllocNode *>(node.get()));
+        case NodeKind::Index:
+            return visitIndex(static_cast<IndexNode *>(node.get()));
+        default:
+            break;
     }
     throw std::runtime_error("Unknown expression node type encountered during evaluation.");
     return Type::UNKNOWN;
@@ -380,7 +636,7 @@ Type SemanticAnalyzer::visitBinaryExpr(const BinaryExprNode *node) {
     } else if (node->op == TokenType::MINUS || node->op == TokenType::MULTIPLY || node->op == TokenType::DIVIDE) {
         if (lhsType == Type::NUMBER && rhsType == Type::NUMBER) {
             if (node->op == TokenType::DIVIDE) {
-                if (const NumberLiteralNode *literal = dynamic_cast<const NumberLiteralNode *>(node->right.get())) {
+                if (const NumberLiteralNode *literal = ast_cast<NumberLiteralNode>(node->right.get())) {
                     if (stoi(literal->value) == 0) {
                         throw std::runtime_error("Division by zero detected at compile time.");
                     }
@@ -450,6 +706,26 @@ Type SemanticAnalyzer::visitLogicalExpr(const LogicalExprNode *node) {
     return Type::NUMBER;
 }
 
+Type SemanticAnalyzer::visitArrayAlloc(const ArrayAllocNode *node) {
+    Type sizeType = evaluateExpression(node->size);
+    if (sizeType != Type::NUMBER) {
+        throw std::runtime_error("Array size must be a number, got " + typeToString(sizeType));
+    }
+    return Type::NUMBER_ARRAY;
+}
+
+Type SemanticAnalyzer::visitIndex(const IndexNode *node) {
+    Type arrayType = evaluateExpression(node->array);
+    if (arrayType != Type::NUMBER_ARRAY) {
+        throw std::runtime_error("Only a number[] can be indexed, got " + typeToString(arrayType));
+    }
+    Type indexType = evaluateExpression(node->index);
+    if (indexType != Type::NUMBER) {
+        throw std::runtime_error("Array index must be a number, got " + typeToString(indexType));
+    }
+    return Type::NUMBER;
+}
+
 void SemanticAnalyzer::printAllSymbolTables() const {
     std::cout << "\n=== All Collected Symbol Tables ===\n";
     for (const auto &[uniqueName, symbolTablePtr] : allSymbolTables) {
@@ -1,4 +1,5 @@
 #include "../include/symbol_table.hpp"
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 
@@ -8,38 +9,100 @@ std::string typeToString(Type type) {
         case Type::STRING: return "string";
         case Type::VOID: return "void";
         case Type::UNKNOWN: return "unknown";
+        case Type::NUMBER_ARRAY: return "number[]";
         default: return "invalid";
     }
 }
 
-void SymbolTable::updateFunctionReturnType(const std::string& name, Type newType) {
-    auto& globalScope = scopes[0];
+const std::vector<std::pair<Type, Symbol>>& SymbolInfo::params() const {
+    static const std::vector<std::pair<Type, Symbol>> none;
+    return signature ? signature->params : none;
+}
 
-    auto it = globalScope.find(name);
-    if (it != globalScope.end()) {
-        if (it->second.isFunction) {
-            it->second.returns = newType;
-        } else {
-            throw std::runtime_error("Error: '" + name + "' is not a function. Cannot update its return type.");
+size_t SymbolTable::findBucket(Symbol name) const {
+    size_t mask = buckets.size() - 1;
+    // Symbols are dense small integers; multiply to spread neighbours apart.
+    size_t index = (static_cast<size_t>(name) * 0x9E3779B97F4A7C15ull >> 32) & mask;
+    while (buckets[index].name != name && buckets[index].name != 0) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+SymbolTable::Bucket& SymbolTable::bucketFor(Symbol name) {
+    size_t index = findBucket(name);
+    if (buckets[index].name == name) {
+        return buckets[index];
+    }
+
+    if ((usedBuckets + 1) * 2 > buckets.size()) {
+        std::vector<Bucket> old(buckets.size() * 2);
+        old.swap(buckets);
+        usedBuckets = 0;
+        for (const Bucket& bucket : old) {
+            if (bucket.top >= 0) {
+                buckets[findBucket(bucket.name)] = bucket;
+                usedBuckets++;
+            }
         }
-    } else {
-        throw std::runtime_error("Error: Function '" + name + "' not found in symbol table for return type update.");
+        index = findBucket(name);
     }
+    buckets[index].name = name;
+    usedBuckets++;
+    return buckets[index];
 }
 
-bool SymbolTable::isDeclaredInCurrentScope(const std::string& name) const {
-    if (scopes.empty()) {
-        return false;
+SymbolInfo& SymbolTable::push(const SymbolInfo& info) {
+    Bucket& bucket = bucketFor(info.name);
+    declarations.push_back({info, bucket.top});
+    bucket.top = static_cast<int>(declarations.size() - 1);
+    return declarations.back().info;
+}
+
+int SymbolTable::levelOf(int declaration) const {
+    auto it = std::upper_bound(scopeStarts.begin(), scopeStarts.end(), static_cast<size_t>(declaration));
+    return static_cast<int>(it - scopeStarts.begin()) - 1;
+}
+
+// The function `name` declared at scope level 0; throws if there is none.
+SymbolInfo& SymbolTable::outermostFunction(Symbol name, const char* update) {
+    size_t index = findBucket(name);
+    int found = buckets[index].name == name ? buckets[index].top : -1;
+    while (found >= 0 && levelOf(found) > 0) {
+        found = declarations[found].shadowed;
+    }
+
+    if (found < 0) {
+        throw std::runtime_error("Error: Function '" + symbolName(name) + "' not found in symbol table for " + update + " update.");
+    }
+    SymbolInfo& info = declarations[found].info;
+    if (!info.isFunction) {
+        throw std::runtime_error("Error: '" + symbolName(name) + "' is not a function. Cannot update its " + update + ".");
     }
-    return scopes.back().count(name);
+    return info;
+}
+
+void SymbolTable::updateFunctionReturnType(Symbol name, Type newType) {
+    outermostFunction(name, "return type").returns = newType;
+}
+
+void SymbolTable::updateFunctionPurity(Symbol name, bool pure) {
+    outermostFunction(name, "purity").isPure = pure;
+}
+
+bool SymbolTable::isDeclaredInCurrentScope(Symbol name) const {
+    size_t index = findBucket(name);
+    return buckets[index].name == name && buckets[index].top >= static_cast<int>(scopeStarts.back());
 }
 void SymbolTable::print(int indent) const {
     std::string indentStr(indent, ' ');
     std::cout << indentStr << "Scope Name: " << currentScopeName << "\n";
-    std::cout << indentStr << "Number of Scope Levels: " << scopes.size() << "\n\n";
+    std::cout << indentStr << "Number of Scope Levels: " << scopeStarts.size() << "\n\n";
+
+    for (size_t level = 0; level < scopeStarts.size(); ++level) {
+        size_t begin = scopeStarts[level];
+        size_t end = level + 1 < scopeStarts.size() ? scopeStarts[level + 1] : declarations.size();
 
-    int level = 0;
-    for (const auto& scopeMap : scopes) {
         std::cout << indentStr << "Scope Level " << level;
         if (level == 0) {
             std::cout << " (Function Scope)";
@@ -48,32 +111,34 @@ void SymbolTable::print(int indent) const {
         }
         std::cout << ":\n";
 
-        if (scopeMap.empty()) {
+        if (begin == end) {
             std::cout << indentStr << "  (No symbols in this scope)\n";
         } else {
-            for (const auto& [name, info] : scopeMap) {
-                std::cout << indentStr << "  Symbol: " << name << "\n";
+            for (size_t i = begin; i < end; ++i) {
+                const SymbolInfo& info = declarations[i].info;
+                std::cout << indentStr << "  Symbol: " << symbolName(info.name) << "\n";
                 std::cout << indentStr << "    Type: " << typeToString(info.type) << "\n";
                 if (info.isFunction) {
                     std::cout << indentStr << "    Kind: Function\n";
                     std::cout << indentStr << "    Returns: " << typeToString(info.returns) << "\n";
+                    std::cout << indentStr << "    Pure: " << (info.isPure ? "Yes" : "No") << "\n";
                     std::cout << indentStr << "    Parameters: ";
-                    if (info.params.empty()) {
+                    if (info.params().empty()) {
                         std::cout << "None\n";
                     } else {
                         std::cout << "\n";
-                        for (const auto& [paramType, paramName] : info.params) {
-                            std::cout << indentStr << "      - " << typeToString(paramType) << " " << paramName << "\n";
+                        for (const auto& [paramType, paramName] : info.params()) {
+                            std::cout << indentStr << "      - " << typeToString(paramType) << " " << symbolName(paramName) << "\n";
                         }
                     }
                 } else {
                     std::cout << indentStr << "    Kind: Variable\n";
+                    std::cout << indentStr << "    Slot: " << info.slot << "\n";
                     std::cout << indentStr << "    Initialized: " << (info.isInitialized ? "Yes" : "No") << "\n";
                 }
             }
         }
         std::cout << "\n--------------------------------------------\n\n";
-        level++;
     }
 
     std::cout << indentStr << "--- End of " << currentScopeName << " ---\n";
@@ -82,103 +147,106 @@ void SymbolTable::print(int indent) const {
 
 
 
-void SymbolTable::printScope(const std::unordered_map<std::string, SymbolInfo>& scope) const {
+void SymbolTable::printScope(const std::unordered_map<Symbol, SymbolInfo>& scope) const {
     for (const auto& [name, info] : scope) {
-        std::cout << "  " << info.name << " : "
+        std::cout << "  " << symbolName(info.name) << " : "
                   << typeToString(info.type)
                   << ", initialized: " << (info.isInitialized ? "yes" : "no")
                   << std::endl;
     }
 }
 
-void SymbolTable::enterScope(const std::string& scopeName) {
-    scopes.emplace_back();
+void SymbolTable::enterScope() {
+    scopeStarts.push_back(declarations.size());
 }
 
 void SymbolTable::exitScope() {
-    if (!scopes.empty()) {
-        scopes.pop_back();
+    if (scopeStarts.size() <= 1) {
+        return;
     }
-}
-bool SymbolTable::declare(const std::string& name, Type type, bool isInitialized) {
-    if (scopes.empty()) {
-        scopes.emplace_back(); 
+    size_t start = scopeStarts.back();
+    scopeStarts.pop_back();
+    while (declarations.size() > start) {
+        buckets[findBucket(declarations.back().info.name)].top = declarations.back().shadowed;
+        declarations.pop_back();
     }
-
-    if (scopes.back().count(name)) { 
-        return false; 
+}
+bool SymbolTable::declare(Symbol name, Type type, bool isInitialized) {
+    if (isDeclaredInCurrentScope(name)) {
+        return false;
     }
-    scopes.back()[name] = SymbolInfo(name, type, {}, Type::UNKNOWN, currentScopeName /* parent can be table name */, {}, false, isInitialized);
+    SymbolInfo& info = push(SymbolInfo(name, type, Type::UNKNOWN, false, isInitialized));
+    info.slot = nextSlot++;
     return true;
 }
 
-bool SymbolTable::declareFunction(const std::string& name, Type returnType, const std::vector<std::pair<Type, std::string>>& params) {
-    if (scopes.empty()) {
-        scopes.emplace_back();
-    }
-    auto& currentScopeMap = scopes.back();
-    if (currentScopeMap.count(name)) {
-        return false; 
+bool SymbolTable::declareFunction(Symbol name, Type returnType, const std::vector<std::pair<Type, Symbol>>& params) {
+    if (isDeclaredInCurrentScope(name)) {
+        return false;
     }
-    currentScopeMap[name] = SymbolInfo(name, Type::VOID , params, returnType, currentScopeName, {}, true, true );
+    SymbolInfo info(name, Type::VOID, returnType, true, true);
+    info.signature = std::make_shared<const FunctionSignature>(FunctionSignature{params, {}});
+    push(info);
     return true;
 }
 
 
-bool SymbolTable::assign(const std::string& name) {
-    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-        auto& scope = *it;
-        auto found = scope.find(name);
-        if (found != scope.end()) {
-            found->second.isInitialized = true;
-            return true;
-        }
+void SymbolTable::define(const SymbolInfo& info) {
+    if (isDeclaredInCurrentScope(info.name)) {
+        declarations[buckets[findBucket(info.name)].top].info = info;
+    } else {
+        push(info);
     }
-    return false;
 }
 
-bool SymbolTable::isDeclared(const std::string& name) const {
-    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-        if (it->count(name)) {
-            return true;
-        }
+bool SymbolTable::assign(Symbol name) {
+    SymbolInfo* info = lookup(name);
+    if (info) {
+        info->isInitialized = true;
+        return true;
     }
     return false;
 }
 
-bool SymbolTable::isInitialized(const std::string& name) const {
-    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-        auto found = it->find(name);
-        if (found != it->end()) {
-            return found->second.isInitialized;
-        }
-    }
-    return false;
+bool SymbolTable::isDeclared(Symbol name) const {
+    return lookup(name) != nullptr;
 }
 
-Type SymbolTable::getType(const std::string& name) const {
-    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-        auto found = it->find(name);
-        if (found != it->end()) {
-            return found->second.type;
-        }
-    }
-    return Type::UNKNOWN;
+bool SymbolTable::isInitialized(Symbol name) const {
+    const SymbolInfo* info = lookup(name);
+    return info && info->isInitialized;
 }
 
-SymbolInfo SymbolTable::getSymbolInfo(const std::string& name) const {
-    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-        auto found = it->find(name);
-        if (found != it->end()) {
-            return found->second;
-        }
+Type SymbolTable::getType(Symbol name) const {
+    const SymbolInfo* info = lookup(name);
+    return info ? info->type : Type::UNKNOWN;
+}
+
+SymbolInfo SymbolTable::getSymbolInfo(Symbol name) const {
+    const SymbolInfo* info = lookup(name);
+    return info ? *info : SymbolInfo();
+}
+
+const SymbolInfo *SymbolTable::lookup(Symbol name, int *depth) const {
+    size_t index = findBucket(name);
+    if (buckets[index].name != name || buckets[index].top < 0) {
+        return nullptr;
+    }
+    int top = buckets[index].top;
+    if (depth) {
+        *depth = levelOf(top);
     }
-    return SymbolInfo();
+    return &declarations[top].info;
 }
 
-std::unordered_map<std::string, SymbolInfo> SymbolTable::getScope() const {
-    if (!scopes.empty()) {
-        return scopes.back();
+SymbolInfo *SymbolTable::lookup(Symbol name, int *depth) {
+    return const_cast<SymbolInfo *>(static_cast<const SymbolTable *>(this)->lookup(name, depth));
+}
+
+std::unordered_map<Symbol, SymbolInfo> SymbolTable::getScope() const {
+    std::unordered_map<Symbol, SymbolInfo> scope;
+    for (size_t i = scopeStarts.back(); i < declarations.size(); ++i) {
+        scope.emplace(declarations[i].info.name, declarations[i].info);
     }
-    return {};
-}
\ No newline at end of file
+    return scope;
+}
@@ -0,0 +1,112 @@
+// Checks which segments IncrementalCompiler::update() reuses after an edit,
+// and that a reused segment ends up exactly as a fresh compile would leave it.
+#include "incremental.hpp"
+#include <iostream>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string &what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+        failures++;
+    }
+}
+
+void checkStats(const IncrementalCompiler &compiler, size_t reparsed, size_t reanalyzed, const std::string &when) {
+    const IncrementalCompiler::Stats &stats = compiler.lastStats();
+    check(stats.reparsed == reparsed, when + ": reparsed " + std::to_string(stats.reparsed) + ", expected " + std::to_string(reparsed));
+    check(stats.reanalyzed == reanalyzed, when + ": reanalyzed " + std::to_string(stats.reanalyzed) + ", expected " + std::to_string(reanalyzed));
+    check(stats.regenerated == reanalyzed, when + ": regenerated " + std::to_string(stats.regenerated) + ", expected " + std::to_string(reanalyzed));
+}
+
+// Same instructions at the same source positions as compiling `source` from scratch.
+void checkMatchesFresh(const IncrementalCompiler &compiler, const std::string &source, const std::string &when) {
+    IncrementalCompiler fresh;
+    check(fresh.update(source), when + ": fresh compile failed");
+    const IR &got = compiler.getIR();
+    const IR &want = fresh.getIR();
+    check(got.instructions.size() == want.instructions.size(), when + ": instruction count differs");
+    for (size_t i = 0; i < got.instructions.size() && i < want.instructions.size(); ++i) {
+        const IRInstruction &a = got.instructions[i];
+        const IRInstruction &b = want.instructions[i];
+        bool same = a.opcode == b.opcode && a.arg1.toString() == b.arg1.toString() && a.arg2.toString() == b.arg2.toString() &&
+                    a.result.toString() == b.result.toString();
+        check(same, when + ": instruction " + std::to_string(i) + " differs");
+        check(got.locationOf(i) == want.locationOf(i), when + ": location of instruction " + std::to_string(i) + " differs");
+    }
+}
+
+// The table registered as `scopeName` exists and carries the same name as
+// after a fresh compile of `source`.
+void checkScope(const IncrementalCompiler &compiler, const std::string &source, const std::string &scopeName, const std::string &when) {
+    IncrementalCompiler fresh;
+    fresh.update(source);
+    try {
+        const std::string &got = compiler.analyzer().getSymbolTable(scopeName).getCurrentScopeName();
+        const std::string &want = fresh.analyzer().getSymbolTable(scopeName).getCurrentScopeName();
+        check(got == want, when + ": table " + scopeName + " is named " + got + ", expected " + want);
+    } catch (const std::runtime_error &e) {
+        check(false, when + ": " + e.what());
+    }
+}
+
+const std::string program =
+    "func square(number n) {\n"
+    "    return n * n;\n"
+    "}\n"
+    "\n"
+    "func sumOfSquares(number n) {\n"
+    "    number total = 0;\n"
+    "    number i = 0;\n"
+    "    while (i < n) {\n"
+    "        total = total + square(i);\n"
+    "        i = i + 1;\n"
+    "    }\n"
+    "    return total;\n"
+    "}\n"
+    "\n"
+    "func main() {\n"
+    "    print(sumOfSquares(10));\n"
+    "}\n";
+
+} // namespace
+
+int main() {
+    IncrementalCompiler compiler;
+
+    check(compiler.update(program), "first compile failed");
+    check(compiler.lastStats().segments == 3, "expected three segments");
+    checkStats(compiler, 3, 3, "first compile");
+
+    // An edit inside one function, on the same lines: only that function is redone.
+    std::string edited = program;
+    edited.replace(edited.find("i = i + 1;"), 10, "i = i + 2;");
+    check(compiler.update(edited), "compile after the middle edit failed");
+    checkStats(compiler, 1, 1, "middle edit");
+    checkMatchesFresh(compiler, edited, "middle edit");
+
+    // A line inserted at the top moves every function down by one; all of
+    // them are reused, with their positions and scope names moved along.
+    std::string inserted = "\n" + edited;
+    check(compiler.update(inserted), "compile after the insertion failed");
+    checkStats(compiler, 0, 0, "line inserted at the top");
+    checkMatchesFresh(compiler, inserted, "line inserted at the top");
+    checkScope(compiler, inserted, "sumOfSquares$6$0", "line inserted at the top");
+    checkScope(compiler, inserted, "main$16$0", "line inserted at the top");
+
+    // And back: the segments move up again.
+    check(compiler.update(edited), "compile after removing the line failed");
+    checkStats(compiler, 0, 0, "line removed again");
+    checkMatchesFresh(compiler, edited, "line removed again");
+    checkScope(compiler, edited, "sumOfSquares$5$0", "line removed again");
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "incremental_test: all checks passed\n";
+    return 0;
+}